@@ -1,74 +1,123 @@
 /******      FFT      ******/
 #include "FFT.h"
+#include <new>							// std::nothrow (so running out of heap for the benchmark buffers doesn't reset the board)
 
 bool printFFTdebug = false;
 bool windowFFT = true;
-double fft_real[N_FFT], fft_imag[N_FFT];
-arduinoFFT FFT = arduinoFFT(fft_real, fft_imag, N_FFT, 10e3);	// Create FFT object
-double curr_volume=0, avg_volume=0;
+int16_t fft_in[N_FFT];
+uint16_t stftHopSize = STFT_HOP_SIZE;
+
+#if FFT_BACKEND == FFT_BACKEND_DOUBLE
+double fft_real[N_FFT], fft_imag[N_FFT];	// Scratch buffers for arduinoFFT
+#else
+int16_t fft_work[N_FFT];	// Scratch buffer for the fixed-point real FFT: N_FFT real samples in, N_FFT/2 interleaved complex bins out (fft_in is left untouched so both backends can be compared on the same input)
+#endif
 
 
 /*********************************************/
 /******      FFT related functions      ******/
 /*********************************************/
-void computeFFT(bool window) {	// Apply the FFT to the input signal adc_values to obtain fft_magn, fft_real, fft_imag
-	uint32_t t_start, t_end;
-	t_start = micros();
+void computeFFTdouble(const int16_t* in, float* magn, double* re, double* im, bool window) {	// Reference backend: fills magn[0..N_FFT/2] with |FFT(in)| using arduinoFFT on the (N_FFT-long) scratch buffers re and im
+	arduinoFFT FFT = arduinoFFT(re, im, N_FFT, F_SAMPLING);
 
+	for (uint16_t i=0; i<N_FFT; ++i) {
+		re[i] = in[i];
+		im[i] = 0;
+	}
 	if (window) {
-		FFT.Windowing(fft_real, N_FFT, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
+		FFT.Windowing(re, N_FFT, FFT_WIN_TYP_HAMMING, FFT_FORWARD);
 	}
 	FFT.Compute(FFT_FORWARD);	// Perform the time-domain -> freq-domain FFT
-	FFT.ComplexToMagnitude();	// Convert RE + j*IM -> |F(w)| and save the result in fft_real
+	FFT.ComplexToMagnitude();	// Convert RE + j*IM -> |F(w)| and save the result in re
+	for (uint16_t i=0; i<=N_FFT/2; ++i) {
+		magn[i] = re[i];
+	}
+}
+
+#if FFT_BACKEND == FFT_BACKEND_FIXED
+void computeFFTfixed(const int16_t* in, float* magn, bool window) {	// Fixed-point backend: fills magn[0..N_FFT/2] with |FFT(in)| using the Q15 engine in fixedFFT.h
+	memcpy(fft_work, in, sizeof(fft_work));
+
+	int8_t shift = fixedFFTnormalize(fft_work, N_FFT);	// Use as many bits as possible (12-bit ADC samples would otherwise waste 3 bits of precision)
+	if (window) {
+		fixedFFTwindowHamming(fft_work);
+	}
+	uint8_t exponent = fixedRealFFT(fft_work, N_FFT);	// The input is real, so pack it into an N_FFT/2-point complex FFT instead of wasting half the work on a zero imaginary part
+
+	const float scale = ldexpf(1, exponent - shift);	// Undo the normalization and the per-stage scaling so magnitudes match the reference backend
+	fixedRealFFTmagnitude(fft_work, N_FFT, scale, magn);
+}
+#endif
+
+void computeFFT(float* magn, bool window) {	// Apply the FFT (with the backend selected by FFT_BACKEND) to fft_in and write |F(w)| of bins 0..N_FFT/2 to magn
+	uint32_t t_start, t_end;
+	t_start = micros();
+
+	#if FFT_BACKEND == FFT_BACKEND_DOUBLE
+		computeFFTdouble(fft_in, magn, fft_real, fft_imag, window);
+	#else
+		computeFFTfixed(fft_in, magn, window);
+	#endif
 	t_end = micros();
 
 	if (printFFTdebug) consolePrintF("@t=%8d ms\t(deltaT=%6d us) -> FFT computed\n", millis(), t_end-t_start);
 }
 
-void performFFT(unsigned int buf_id, bool apply_EMA) {	// "FFT.loop()" function: computes the FFT on the adc_buf[buf_id]
-	const double F_s = 10e3, FILT_ALPHA = 0.9;	// FILT_ALPHA specifies the alpha component of the Exponential Moving Average (EMA) for the high-pass filt (removes DC component)
-	static double mean_signal;					// Compute the average (EMA or arithmetic) to remove the DC component in the signal (centered at Vcc/2)
-	static bool applied_EMA_last_iter = false;	// Helper flag to initialize mean_signal = adc_buf[buf_id][0] if apply_EMA was false and now is true
-	double curr_total_power = 0;
-	uint32_t t_start, t_end;
+void setSTFThopSize(uint16_t hop) {	// Sets how many new samples trigger a new FFT frame (N_FFT/2 = 50% overlap, N_FFT/4 = 75%...)
+	stftHopSize = constrain(hop, 1, N_FFT);
+}
 
-	t_start = micros();	// Record current time so we can later estimate the sampling freq F_s
+void stftSlide() {	// Shifts fft_in by stftHopSize samples and appends the next stftHopSize (DC-removed) samples from adcRing
+	const int32_t FILT_ALPHA_Q8 = 230;	// FILT_ALPHA_Q8 specifies the alpha component (~0.9, in Q8) of the Exponential Moving Average (EMA) for the high-pass filt (removes DC component)
+	static int32_t mean_signal = -1;	// EMA (in Q8) to remove the DC component in the signal (centered at Vcc/2)
 
-	if (!apply_EMA) {
-		mean_signal = 0;	// Reset counter for arithmetic mean
-	} else if (!applied_EMA_last_iter && apply_EMA) {	// Reset mean_signal if we weren't applying it before and now we do (otherwise it might take too long to converge to the real mean, since signal is centered around Vcc/2)
-		mean_signal = adc_buf[buf_id][0];	// Assume current ADC reading is close to the actual mean
-	}
+	memmove(fft_in, fft_in + stftHopSize, sizeof(fft_in[0])*(N_FFT - stftHopSize));
+	for (uint16_t i=N_FFT-stftHopSize; i<N_FFT; ) {
+		const uint16_t* span;
+		uint16_t n = min(adcRing.peek(span), (uint16_t)(N_FFT-i));	// Read the samples in place (at most 2 contiguous spans if the hop wraps around the ring)
+		if (mean_signal < 0) {	// Initialize mean_signal on the first sample (otherwise it might take too long to converge to the real mean, since signal is centered around Vcc/2)
+			mean_signal = (int32_t)span[0] << 8;	// Assume current ADC reading is close to the actual mean
+		}
 
-	for (uint16_t i=0; i<N_FFT; ++i) {
-		if (apply_EMA) {
-			mean_signal = FILT_ALPHA*mean_signal + (1-FILT_ALPHA)*adc_buf[buf_id][i];	// Update the moving average
-			fft_real[i] = adc_buf[buf_id][i] - mean_signal;	// High-pass filter (to remove DC component): signal-LowPassFilt = signal-mean_EMA
-		} else {	// Compute the arithmetic mean
-			fft_real[i] = adc_buf[buf_id][i];
-			mean_signal += fft_real[i]/N_FFT;	// Accumulate mean value of input signal (so we can later subtract it and we don't have a DC component)
+		for (uint16_t j=0; j<n; ++j, ++i) {
+			mean_signal += ((((int32_t)span[j] << 8) - mean_signal) * (256-FILT_ALPHA_Q8)) >> 8;	// Update the moving average
+			fft_in[i] = span[j] - ((mean_signal + 128) >> 8);	// High-pass filter (to remove DC component): signal-LowPassFilt = signal-mean_EMA
 		}
-		fft_imag[i] = 0;
+		adcRing.consume(n);
 	}
+}
 
-	if (apply_EMA) {	// Update the EMA through the remainder of the signal points that didn't fit in the FFT
-		for (uint16_t i=N_FFT; i<ADC_BUF_SIZE; ++i) {
-			mean_signal = FILT_ALPHA*mean_signal + (1-FILT_ALPHA)*adc_buf[buf_id][i];
-		}
-	} else {	// If arithmetic mean, subtract the mean from the signal (so we don't have a DC component)
-		for (uint16_t i=0; i<N_FFT; ++i) {
-			fft_real[i] -= mean_signal;
-		}
+void benchmarkFFT(Print& out) {	// Runs both backends on the last fft_in and prints their timing and a bin-by-bin comparison to out
+	std::unique_ptr<double[]> re(new (std::nothrow) double[N_FFT]), im(new (std::nothrow) double[N_FFT]);	// The reference backend needs 8KB of scratch buffers, only allocate them while benchmarking
+	std::unique_ptr<float[]> magnRef(new (std::nothrow) float[N_FFT/2 + 1]), magnFixed(new (std::nothrow) float[N_FFT/2 + 1]);
+	if (!re || !im || !magnRef || !magnFixed) {
+		out.printf(CF("Not enough heap to benchmark the FFT backends (%d B free) :(\n"), ESP.getFreeHeap());
+		return;
 	}
 
-	computeFFT(windowFFT);
+	for (uint8_t window=0; window<=1; ++window) {
+		uint32_t t_start = micros();
+		computeFFTdouble(fft_in, magnRef.get(), re.get(), im.get(), window);
+		uint32_t t_ref = micros() - t_start;
 
-	curr_volume = fft_real[0];
-	for (uint16_t i=1; i<=N_FFT/2; ++i) {
-		curr_volume += fft_real[i];
+		t_start = micros();
+		#if FFT_BACKEND == FFT_BACKEND_FIXED
+			computeFFTfixed(fft_in, magnFixed.get(), window);
+		#else
+			memcpy(magnFixed.get(), magnRef.get(), sizeof(magnRef[0])*(N_FFT/2 + 1));	// Fixed backend isn't compiled in, compare the reference against itself
+		#endif
+		uint32_t t_fixed = micros() - t_start;
+
+		float peak = 0, maxErr = 0;
+		for (uint16_t i=0; i<=N_FFT/2; ++i) {
+			peak = max(peak, magnRef[i]);
+			maxErr = max(maxErr, fabsf(magnFixed[i] - magnRef[i]));
+		}
+		out.printf(CF("%s window: double %6u us, fixed %6u us (x%.1f); max |err| = %.1f (%.3f%% of peak %.1f)\n"), window? "Hamming":"No", t_ref, t_fixed, t_ref/(float)max(t_fixed, 1u), maxErr, (peak>0)? 100*maxErr/peak:0, peak);
+		out.printf(CF("bin\t  double\t   fixed\t     err\n"));
+		for (uint16_t i=0; i<=N_FFT/2; ++i) {
+			out.printf(CF("%3u\t%8.1f\t%8.1f\t%8.1f\n"), i, magnRef[i], magnFixed[i], magnFixed[i] - magnRef[i]);
+		}
+		out.printf(CF("\n"));
 	}
-	avg_volume = AVG_VOLUME_ALPHA*avg_volume + (1-AVG_VOLUME_ALPHA)*curr_volume;
-	t_end = micros();
-	if (printFFTdebug) consolePrintF("@t=%8d ms\t(deltaT=%6d us) -> FFT fully processed (curr_vol=%7.1f; avg_vol=%7.1f; mean_signal=%7.2f)\n", millis(), t_end-t_start, curr_volume, avg_volume, mean_signal);
 }
-
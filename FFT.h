@@ -3,21 +3,35 @@
 #define FFT_H_
 
 #include "main.h"						// Global includes and definitions
-#include <arduinoFFT.h>					// FFT
+#include "fixedFFT.h"					// Q15 fixed-point FFT engine (default backend)
+#include <arduinoFFT.h>					// FFT (double-precision reference backend)
 
 #define N_FFT				512
-#define AVG_VOLUME_ALPHA	0.95
+#define F_SAMPLING			10e3
+#define STFT_HOP_SIZE		(N_FFT/2)	// Default number of new samples per FFT frame: 50% overlap -> 25.6ms between spectra at F_SAMPLING
+#define FFT_BACKEND_DOUBLE	0		// arduinoFFT on double-precision buffers: slow on the ESP8266 (no FPU), kept as the accuracy reference
+#define FFT_BACKEND_FIXED	1		// Q15 fixed-point real-input FFT (fixedFFT.h): integer-only, 1KB of scratch RAM instead of the 8KB of the double backend
+#ifndef FFT_BACKEND			// (Can be overridden from the compiler's command line)
+#define FFT_BACKEND			FFT_BACKEND_FIXED
+#endif
+
+#if N_FFT != FIXED_FFT_N_MAX
+#error "The fixed-point FFT tables (fixedFFT.cpp) are precomputed for N_FFT == FIXED_FFT_N_MAX"
+#endif
 
-extern double curr_volume, avg_volume;
-extern double fft_real[N_FFT];
+extern uint16_t stftHopSize;			// Number of new samples between consecutive FFT frames
+extern int16_t fft_in[N_FFT];			// Input of the last FFT (sliding STFT window): ADC samples with the DC component removed
 extern bool windowFFT;
 
 
 /*********************************************/
 /******      FFT related functions      ******/
 /*********************************************/
-void computeFFT(bool window);
-void performFFT(unsigned int buf_id, bool apply_EMA = true);
+void computeFFTdouble(const int16_t* in, float* magn, double* re, double* im, bool window);	// Reference backend: fills magn[0..N_FFT/2] with |FFT(in)| using arduinoFFT on the (N_FFT-long) scratch buffers re and im
+void computeFFTfixed(const int16_t* in, float* magn, bool window);	// Fixed-point backend: fills magn[0..N_FFT/2] with |FFT(in)| using the Q15 engine in fixedFFT.h
+void computeFFT(float* magn, bool window);	// Apply the FFT (with the backend selected by FFT_BACKEND) to fft_in and write |F(w)| of bins 0..N_FFT/2 to magn
+void setSTFThopSize(uint16_t hop);		// Sets how many new samples trigger a new FFT frame (N_FFT/2 = 50% overlap, N_FFT/4 = 75%...)
+void stftSlide();						// Shifts fft_in by stftHopSize samples and appends the next stftHopSize (DC-removed) samples from adcRing
+void benchmarkFFT(Print& out);	// Runs both backends on the last fft_in and prints their timing and a bin-by-bin comparison to out
 
 #endif
-
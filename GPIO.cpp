@@ -5,10 +5,7 @@ byte gpioExpPortA = 0, gpioExpPortB = 0;
 byte relayStatus = 0xFF;	// Relays are active-low, so let's start with all the relays off
 uint8_t audioKnobInCh = 0, audioOutCh = 0;
 
-uint16_t adc_buf[2][ADC_BUF_SIZE];		// ADC data buffer, double buffered
-unsigned int adc_buf_id_current = 0;	// Which data buffer is being used for the ADC (the other is being sent)
-unsigned int adc_buf_pos = 0;			// Position (index) in the ADC data buffer (index in adc_buf[adc_buf_id_current])
-bool adc_buf_got_full = false;			// Flag to signal that a buffer is ready to be sent
+SPSCRingBuffer<uint16_t, ADC_RING_SIZE> adcRing;	// ADC samples: written by sample_isr, read by the STFT (FFT.cpp)
 
 #define TEMP_PIN_LIGHTS1	14	// 15
 #define TEMP_PIN_LIGHTS2	12	// 13
@@ -49,12 +46,16 @@ static inline void setDataBits(uint16_t bits) {	// Sets up SPI with the given nu
 }
 
 void setupExternalADC() {	// Configure SPI to communicate with the external ADC (MCP3201)
+#if ADC_SOURCE == ADC_SOURCE_SYNTH
+	setupSynthADC();	// No need to touch SPI, samples are generated by sample_isr
+#else
 	SPI.begin();
 	SPI.setDataMode(SPI_MODE0);
 	SPI.setBitOrder(MSBFIRST);
 	SPI.setClockDivider(SPI_CLOCK_DIV8); 
 	SPI.setHwCs(1);
 	setDataBits(16);
+#endif
 	setupTimer1();	// And start the timer to sample ADC
 }
 
@@ -200,18 +201,12 @@ static inline ICACHE_RAM_ATTR uint16_t transfer16() {	// Read 16 bits from SPI
 	return out.val;
 }
 
-void ICACHE_RAM_ATTR sample_isr() {	// Samples the ADC and pushes the value to the adc_buf (switches to a new buffer if full)
-	// Read a sample from ADC and write it to the buffer
-	uint16_t val = transfer16();	// Read ADC (through SPI)
-	adc_buf[adc_buf_id_current][adc_buf_pos] = val;	// Save the value in the buffer
-	adc_buf_pos++;	// And increase the buffer cursor
-
-	// If the buffer is full, switch to the other one and signal that it's ready to be sent
-	if (adc_buf_pos > sizeof(adc_buf[0])/sizeof(adc_buf[0][0])) {
-		adc_buf_pos = 0;
-		adc_buf_id_current = !adc_buf_id_current;
-		adc_buf_got_full = true;
-	}
+void ICACHE_RAM_ATTR sample_isr() {	// Samples the ADC (or the synthetic source, depending on ADC_SOURCE) and pushes the value to adcRing (counts an overrun if the main loop fell behind and it's full)
+#if ADC_SOURCE == ADC_SOURCE_SYNTH
+	adcRing.push(synthADCsample());
+#else
+	adcRing.push(transfer16());	// Read ADC (through SPI) and save the value in the ring
+#endif
 }
 
 void processGPIO() {	// "GPIO.loop()" function: reads inputs, processes them and writes outputs
@@ -6,6 +6,8 @@
 #include <Wire.h>				// I2C library (GPIO expander)
 #include <SPI.h>				// SPI library (external ADC)
 #include <ESPAsyncWebServer.h>	// HTTP web server to handle requests to turn on/off lights, sound, etc.
+#include "ringBuffer.h"			// Lock-free ring buffer between the ADC sampling ISR and the main loop
+#include "synthADC.h"			// Synthetic audio source (ADC_SOURCE_SYNTH)
 
 #define GPIO_EXP_ADDR	0x20	// Only last 3 bits of address could be changed (0x20-0x27). Currently all bits are shorted to GND, so 0x20
 #define GPIO_EXP_IODIRA	0x00	// IODIRA register controls IO direction for port A: 0=output, 1=input
@@ -18,15 +20,18 @@
 #define RELAY_LIGHTS2	5
 #define RELAY_MUSIC		6
 #define PWMRANGE		1023
-#define ADC_BUF_SIZE	1000
+#define ADC_RING_SIZE	2048	// (Power of 2) Number of ADC samples the ring can hold before sample_isr starts dropping them (~200ms at 10kHz)
+#define ADC_SOURCE_MCP3201	0	// sample_isr reads the external ADC (MCP3201) through SPI
+#define ADC_SOURCE_SYNTH	1	// sample_isr generates a synthetic test signal instead (see synthADC.h), so the audio and LED pipeline can be run and profiled without the analog front end
+#ifndef ADC_SOURCE			// (Can be overridden from the compiler's command line)
+#define ADC_SOURCE		ADC_SOURCE_MCP3201
+#endif
+#define GPIO_POLL_INTERVAL	50		// (ms) How often processGPIO reads the audio knob and updates the relays
 
 extern byte gpioExpPortA, gpioExpPortB;		// Local copy of last known status of MCP23017's PORTA and PORTB
 extern byte relayStatus;					// (Active-low) relay control signal, decides which relays to turn on/off
 extern uint8_t audioKnobInCh, audioOutCh;	// Selected channel input in the audio knob and desired channel output
-extern uint16_t adc_buf[2][ADC_BUF_SIZE];	// ADC data buffer, double buffered
-extern unsigned int adc_buf_id_current;		// Which data buffer is being used for the ADC (the other is being sent)
-extern unsigned int adc_buf_pos;			// Position (index) in the ADC data buffer (index in adc_buf[adc_buf_id_current])
-extern bool adc_buf_got_full;				// Flag to signal that a buffer is ready to be sent
+extern SPSCRingBuffer<uint16_t, ADC_RING_SIZE> adcRing;	// ADC samples: written by sample_isr, read by the STFT (FFT.cpp)
 
 
 /***************************************************/
@@ -50,7 +55,7 @@ uint8_t getAudioKnobSelectedCh();				// Find out which channel is the audio knob
 void sendAudioSelectedCh();						// Write to MCP23017's PORTA the appropriate value based on desired audioOutCh
 void setRelay(uint8_t num, bool setOn);			// Turn on/off the num-th relay
 static inline ICACHE_RAM_ATTR uint16_t transfer16();	// Read 16 bits from SPI
-void ICACHE_RAM_ATTR sample_isr();				// Samples the ADC and pushes the value to the adc_buf (switches to a new buffer if full)
+void ICACHE_RAM_ATTR sample_isr();				// Samples the ADC (or the synthetic source, depending on ADC_SOURCE) and pushes the value to adcRing (counts an overrun if the main loop fell behind and it's full)
 void processGPIO();								// "GPIO.loop()" function: reads inputs, processes them and writes outputs
 
 /**** Dirty way to get Relay control until MCP23017 arrives (START) ****/
@@ -2,11 +2,15 @@
 #include "main.h"
 #include "GPIO.h"
 #include "FFT.h"
+#include "audio.h"
 #include "OLED.h"
 #include "fileIO.h"
 #include "WiFi.h"
 #include "webServer.h"
 #include "ledStrip.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "persistence.h"
 
 uint32_t curr_time;
 
@@ -21,11 +25,22 @@ void setup() {
 	while(!Serial);	// Wait for serial port to connect
 
 	setupIOpins();
+	setupAudio();
 	setupOLEDdisplay();
-	setupWiFi();
 	setupFileIO();
+	setupPersistence();	// (Before setupWiFi and setupLedStrip load their settings)
+	setupWiFi();
 	setupWebServer();
 	setupLedStrip();
+
+	// Register the tasks in priority order: audio first (so adcRing doesn't overflow), then the LED strip (frame rate), then everything else
+	addSchedulerTask("audio",     processAudio,     0,                        audioFrameReady, 20,  PROFILE_AUDIO);
+	addSchedulerTask("ledStrip",  processLedStrip,  LED_STRIP_FRAME_INTERVAL, NULL,            5,   PROFILE_LED_STRIP);
+	addSchedulerTask("webServer", processWebServer, WEB_SERVER_POLL_INTERVAL, NULL,            50,  PROFILE_WEB_SERVER);
+	addSchedulerTask("OLED",      processOLED,      OLED_REFRESH_INTERVAL,    NULL,            50,  PROFILE_OLED);
+	addSchedulerTask("GPIO",      processGPIO,      GPIO_POLL_INTERVAL,       NULL,            50,  PROFILE_GPIO);
+	addSchedulerTask("WiFi",      processWiFi,      WIFI_POLL_INTERVAL,       NULL,            500, PROFILE_WIFI);
+	addSchedulerIdleTask("persist", processPersistence, persistencePending, PROFILE_PERSIST);	// Settings are written to flash in idle slots, a chunk at a time
 }
 
 
@@ -33,14 +48,5 @@ void setup() {
 /******            MAIN LOOP            ******/
 /*********************************************/
 void loop() {
-	curr_time = millis();
-	
-	processGPIO();
-	processOLED();
-	processLedStrip();
-	processWebServer();
-	processWiFi();
-
-	delay(10);
+	runScheduler();
 }
-
@@ -1,5 +1,6 @@
 /******      OLED display      ******/
 #include "OLED.h"
+#include "audio.h"						// Audio analysis so we can draw a histogram of current sound on the screen. Included in the cpp file: main.h includes OLED.h before FFT.h has defined N_FFT
 
 #if USE_OLED_DISP
 Adafruit_SSD1306 display(-1);		// If we pass a number as the first parameter, it would be used as the OLED_RESET pin (-1 for no reset)
@@ -38,10 +39,11 @@ void oledDrawVLineFromBottom(uint8_t x, uint8_t h, uint16_t color) {	// Helper f
 
 void processOLED() {	// "OLED.loop()" function: turn the screen into an audio spectrum analyzer (histogram of each freq bin's power)
 	#if USE_OLED_DISP
+		const AudioFrame& audio = getAudioFrame();
 		display.clearDisplay();
 		
 		for (uint16_t i=0; i<=N_FFT/2; ++i) {
-			oledDrawVLineFromBottom(i, fft_magn[i]/4000*SSD1306_LCDHEIGHT);
+			oledDrawVLineFromBottom(i, audio.spectrum[i]/4000*SSD1306_LCDHEIGHT);
 		}
 		
 		display.display();
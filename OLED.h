@@ -3,9 +3,9 @@
 #define OLED_H_
 
 #include "main.h"						// HotTub global includes and definitions
-#include "FFT.h"						// FFT library so we can draw a histogram of current sound on the screen
 
 #define USE_OLED_DISP	false
+#define OLED_REFRESH_INTERVAL	50	// (ms) How often processOLED redraws the spectrum
 
 #if USE_OLED_DISP
 #include <Adafruit_SSD1306.h>			// OLED display
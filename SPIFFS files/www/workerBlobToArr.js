@@ -26,10 +26,13 @@ function convertBlobToBinArray(blob, toType) {
 	var blobToArrBuffConverter = new FileReader();	// Use helper class FileReader to convert Blob data (default class for binary ws data) to UInt16Array
 	blobToArrBuffConverter.onload = function() {
 		var binDataArr;
-		switch (toType) {	// Once converted, cast the ArrayBuffer (this.result) to the requested binary type (uint16_t, double, etc.)
+		switch (toType) {	// Once converted, cast the ArrayBuffer (this.result) to the requested binary type (uint16_t, float, double, etc.)
 			case 'double':
 				binDataArr = new Float64Array(this.result);
 				break;
+			case 'float':
+				binDataArr = new Float32Array(this.result);
+				break;
 			default:
 			case 'uint16_t':
 				binDataArr = new Uint16Array(this.result);
@@ -5,6 +5,7 @@ char wlanSSID[32], wlanPass[32];
 IPAddress wlanMyIP, wlanGateway, wlanMask;
 const String strWlanConfigOk(WLAN_CONFIG_OK_STR);
 uint32_t tNextWiFiReconnectAttempt = -1;
+int8_t wlanConfigPersistId = -1;	// WLAN credentials, as a persistence target (see markPersistDirty)
 
 
 /***************************************************/
@@ -18,6 +19,7 @@ void setupWiFi() {	// "Publicly-visible" initialization routine for WiFi connect
 		display.println(WiFi.softAPIP());
 		display.display();
 	#endif
+	wlanConfigPersistId = addPersistTarget("WLAN", NULL, NULL, writeWLANconfig, 0, 0);	// (Written as soon as there's an idle slot: there's nothing to coalesce)
 	loadWLANConfig();	// Load settings from EEPROM like which network we want to connect to
 	connectToWLAN();	// And then try to connect to it
 }
@@ -90,7 +92,11 @@ void loadWLANConfig() {	// Load WLAN credentials from EEPROM
 	consolePrintF("Recovered WLAN credentials:\n\tSSID: %s\n\tPass: %s\n\tIP: %s\n\tGateway: %s\n\tMask: %s\n", strlen(wlanSSID)>0? wlanSSID:SF("<No SSID>").c_str(), strlen(wlanPass)>0? wlanPass:SF("<No password>").c_str(), wlanMyIP.toString().c_str(), wlanGateway.toString().c_str(), wlanMask.toString().c_str());
 }
 
-void saveWLANconfig() {	// Save WLAN credentials to EEPROM
+void saveWLANconfig() {	// Schedules saving WLAN credentials to EEPROM (see writeWLANconfig)
+	markPersistDirty(wlanConfigPersistId);	// (Can be called from AsyncWebServer's callbacks, where an EEPROM commit doesn't belong)
+}
+
+bool writeWLANconfig() {	// Writes WLAN credentials to EEPROM (called by the persistence service)
 	uint16_t memStart = 0;
 	char ok[2+1] = WLAN_CONFIG_OK_STR;
 	
@@ -106,8 +112,9 @@ void saveWLANconfig() {	// Save WLAN credentials to EEPROM
 	EEPROM.put(memStart, wlanMask);
 	memStart += sizeof(wlanMask);
 	EEPROM.put(memStart, ok);
-	EEPROM.commit();
+	bool committed = EEPROM.commit();
 	EEPROM.end();
+	return committed;
 }
 
 void processWiFi() {	// "WiFi.loop()" function: tries to reconnect to known networks if haven't been able to do so for the past WIFI_T_RECONNECT ms and createWiFiAP == false
@@ -5,6 +5,7 @@
 #include "main.h"						// HotTub global includes and definitions
 #include <EEPROM.h>						// EEPROM is used to store WLAN configuration (SSID, pass, IP, etc.)
 #include <IPAddress.h>					// IPAddresses are used for WLAN configuration
+#include "persistence.h"				// WLAN configuration is written to the EEPROM in the background
 
 #define SOFT_AP_IP			IPAddress(192, 168, 0, 1)
 #define SOFT_AP_MASK		IPAddress(255, 255, 255, 0)
@@ -12,6 +13,7 @@
 #define WLAN_CONFIG_OK_STR	"Ok"
 #define WIFI_T_CONNECT		5000	// (ms) Indicates how long the Arduino has to successfully connect to a known network. If after WIFI_T_CONNECT ms it still hasn't connected, it will set up its own AP
 #define WIFI_T_RECONNECT	60000	// (ms) If createWiFiAP is false but can't connect to any known network, we'll create our own AP and try to connect to known networks again after WIFI_T_RECONNECT ms
+#define WIFI_POLL_INTERVAL	500		// (ms) How often processWiFi checks the connection
 
 extern char wlanSSID[32], wlanPass[32];
 extern IPAddress wlanMyIP, wlanGateway, wlanMask;
@@ -30,7 +32,8 @@ void connectToWLAN();	// Connect to saved WLAN network
 /**********************************************/
 void loadDefaultWiFiConfig();	// Loads default WLAN credentials (if couldn't load them from the EEPROM)
 void loadWLANConfig();			// Load WLAN credentials from EEPROM
-void saveWLANconfig();			// Save WLAN credentials to EEPROM
+void saveWLANconfig();			// Schedules saving WLAN credentials to EEPROM (see writeWLANconfig)
+bool writeWLANconfig();			// Writes WLAN credentials to EEPROM (called by the persistence service)
 void processWiFi();				// "WiFi.loop()" function: tries to reconnect to known networks if haven't been able to do so for the past WIFI_T_RECONNECT ms and createWiFiAP == false
 
 #endif
@@ -0,0 +1,124 @@
+/******      Audio analysis      ******/
+#include "audio.h"
+
+bool printAudioDebug = false;
+AudioFrame audioFrames[2];	// Double buffered: processAudio() fills audioFrames[!audioFrameIdx] and then publishes it by flipping audioFrameIdx
+uint8_t audioFrameIdx = 0;
+BeatDetector beatDetector;
+float avgVolumeAlpha, avgBandsAlpha;	// EMA alphas per STFT frame (depend on stftHopSize, see updateAudioAlphas)
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+void setupAudio() {	// Initializes the STFT parameters
+	setSTFThopSize(STFT_HOP_SIZE);
+}
+
+
+/***********************************************/
+/******      Audio related functions      ******/
+/***********************************************/
+constexpr double constexprLnSeries(double y2, double term, uint8_t n) {	// Helper for constexprLn: sum of term*y2^k/(2(n+k)+1) for k=0.. (until it converges)
+	return (n > 30)? 0 : term/(2*n+1) + constexprLnSeries(y2, term*y2, n+1);
+}
+
+constexpr double constexprLn(double x) {	// Natural logarithm that the compiler can evaluate (x>0): halves/doubles x until it's within [0.5, 2], then ln(x) = 2*atanh((x-1)/(x+1))
+	return (x > 2)? M_LN2 + constexprLn(x/2) : (x < 0.5)? constexprLn(2*x) - M_LN2 : 2*constexprLnSeries(((x-1)/(x+1))*((x-1)/(x+1)), (x-1)/(x+1), 0);
+}
+
+constexpr double audioBandScale(double f) {	// Frequency warping used to space the bands (the mel scale is 2595*log10(1 + f/700), the constant factor doesn't matter here)
+	return (AUDIO_BAND_SCALE == AUDIO_BAND_SCALE_MEL)? constexprLn(1 + f/700) : constexprLn(f);
+}
+
+constexpr uint8_t audioBandOfBin(uint16_t i) {	// (Compile-time) Returns which band FFT bin i belongs to (or N_AUDIO_BANDS if it's below AUDIO_BAND_F_MIN)
+	return (i*F_SAMPLING/N_FFT < AUDIO_BAND_F_MIN)? N_AUDIO_BANDS :
+		min(N_AUDIO_BANDS-1, (int)(N_AUDIO_BANDS*(audioBandScale(i*F_SAMPLING/N_FFT) - audioBandScale(AUDIO_BAND_F_MIN)) / (audioBandScale(F_SAMPLING/2) - audioBandScale(AUDIO_BAND_F_MIN))));
+}
+
+#if N_FFT != 512
+#error "audioBinBands is unrolled for N_FFT == 512, update AUDIO_BIN_BANDS_256 accordingly"
+#endif
+#define AUDIO_BIN_BANDS_1(i)	audioBandOfBin(i)
+#define AUDIO_BIN_BANDS_4(i)	AUDIO_BIN_BANDS_1(i), AUDIO_BIN_BANDS_1(i+1), AUDIO_BIN_BANDS_1(i+2), AUDIO_BIN_BANDS_1(i+3)
+#define AUDIO_BIN_BANDS_16(i)	AUDIO_BIN_BANDS_4(i), AUDIO_BIN_BANDS_4(i+4), AUDIO_BIN_BANDS_4(i+8), AUDIO_BIN_BANDS_4(i+12)
+#define AUDIO_BIN_BANDS_64(i)	AUDIO_BIN_BANDS_16(i), AUDIO_BIN_BANDS_16(i+16), AUDIO_BIN_BANDS_16(i+32), AUDIO_BIN_BANDS_16(i+48)
+#define AUDIO_BIN_BANDS_256(i)	AUDIO_BIN_BANDS_64(i), AUDIO_BIN_BANDS_64(i+64), AUDIO_BIN_BANDS_64(i+128), AUDIO_BIN_BANDS_64(i+192)
+const uint8_t PROGMEM audioBinBands[N_FFT/2 + 1] = {AUDIO_BIN_BANDS_256(0), AUDIO_BIN_BANDS_1(N_FFT/2)};	// Band each FFT bin belongs to, generated by the compiler so processAudio only needs one pass over the bins
+
+const AudioFrame& getAudioFrame() {	// Returns the last published AudioFrame. Only valid until the next call to processAudio() (frames are double buffered)
+	return audioFrames[audioFrameIdx];
+}
+
+void updateAudioAlphas() {	// Recomputes avgVolumeAlpha and avgBandsAlpha if stftHopSize changed
+	static uint16_t alphaHopSize = 0;	// stftHopSize avgVolumeAlpha and avgBandsAlpha were computed for
+	if (alphaHopSize == stftHopSize) return;
+
+	alphaHopSize = stftHopSize;
+	avgVolumeAlpha = powf(AVG_VOLUME_ALPHA, stftHopSize/(float)AVG_VOLUME_ALPHA_SAMPLES);	// Keep avgVolume's time constant regardless of the frame rate
+	avgBandsAlpha = powf(AUDIO_BANDS_ALPHA, stftHopSize/(float)AVG_VOLUME_ALPHA_SAMPLES);
+}
+
+void analyzeAudioFrame(AudioFrame& frame, const AudioFrame& prev, BeatDetector& detector, uint8_t nHops) {	// Fills frame's spectrum, volume, bands, EMAs (continuing prev's, nHops ago) and beat info (from detector) from the current STFT window. Doesn't touch frame.id nor frame.t
+	updateAudioAlphas();
+	const float volumeAlpha = (nHops > 1)? powf(avgVolumeAlpha, nHops) : avgVolumeAlpha;	// The EMAs decay as much as if every hop had been analysed, so their time constants don't stretch when processAudio falls behind
+	const float bandsAlpha = (nHops > 1)? powf(avgBandsAlpha, nHops) : avgBandsAlpha;
+	computeFFT(frame.spectrum, windowFFT);
+
+	float bands[N_AUDIO_BANDS + 1] = {0};	// Extra band collects the bins below AUDIO_BAND_F_MIN
+	frame.volume = 0;
+	for (uint16_t i=0; i<=N_FFT/2; ++i) {
+		frame.volume += frame.spectrum[i];
+		bands[pgm_read_byte(&audioBinBands[i])] += frame.spectrum[i];
+	}
+	for (uint8_t b=0; b<N_AUDIO_BANDS; ++b) {
+		frame.bands[b] = bands[b];
+		frame.avgBands[b] = bandsAlpha*prev.avgBands[b] + (1-bandsAlpha)*bands[b];
+	}
+	frame.avgVolume = volumeAlpha*prev.avgVolume + (1-volumeAlpha)*frame.volume;
+
+	detector.process(frame.bands, N_AUDIO_BANDS, frame.t, nHops);
+	frame.flux = detector.flux;
+	frame.onset = detector.onset;
+	frame.beat = detector.beat;
+	frame.bpm = detector.bpm;
+	frame.beatPeriod = detector.beatPeriod;
+	frame.tLastBeat = detector.tLastBeat;
+}
+
+bool audioFrameReady() {	// Returns whether adcRing holds enough new samples for processAudio() to compute a new frame (the scheduler's readiness predicate for the audio task)
+	return adcRing.available() >= stftHopSize;
+}
+
+void processAudio() {	// "Audio.loop()" function: slides the STFT window over every full hop of new samples in adcRing and publishes the analysis of the latest one
+	uint16_t nHops = 0;
+	uint32_t t_start, t_end;
+
+	t_start = micros();
+
+	uint32_t available = adcRing.available();
+	uint32_t t_now = millis();
+
+	while (available >= stftHopSize) {
+		stftSlide();
+		available -= stftHopSize;
+		++nHops;
+		// If we fell behind, the older hops only slide the window (no FFT) so we catch up in bounded time. The EMAs and the beat detector are
+		// told how many hops the frame spans: the EMAs decay for all of them and the detector doesn't take the flux across the gap as an onset
+		if (available >= stftHopSize) continue;
+
+		const AudioFrame& prev = audioFrames[audioFrameIdx];
+		AudioFrame& frame = audioFrames[!audioFrameIdx];
+		frame.t = t_now - available*1000/(uint32_t)F_SAMPLING;	// Time at which the newest sample in the window was taken
+		frame.id = prev.id + 1;
+		analyzeAudioFrame(frame, prev, beatDetector, min(nHops, (uint16_t)255));	// (Every hop since the last published frame)
+		audioFrameIdx = !audioFrameIdx;	// Publish the frame
+	}
+
+	t_end = micros();
+	if (printAudioDebug && nHops>0) {
+		const AudioFrame& frame = getAudioFrame();
+		consolePrintF("@t=%8d ms\t(deltaT=%6d us) -> %d hop(s) processed (frame #%u @t=%u ms; vol=%7.1f; avg_vol=%7.1f; ADC overruns: %u)\n", millis(), t_end-t_start, nHops, frame.id, frame.t, frame.volume, frame.avgVolume, adcRing.getOverruns());
+		if (frame.onset || frame.beat) consolePrintF("\t%s%s (flux=%5.2f; %5.1f BPM)\n", frame.onset? "ONSET ":"", frame.beat? "BEAT":"", frame.flux, frame.bpm);
+	}
+}
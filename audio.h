@@ -0,0 +1,54 @@
+/******      Audio analysis      ******/
+#ifndef AUDIO_H_
+#define AUDIO_H_
+
+#include "main.h"						// Global includes and definitions
+#include "GPIO.h"						// adcRing (source of the audio samples)
+#include "FFT.h"						// STFT and FFT engine
+#include "beatDetector.h"				// Onset detection and tempo tracking
+
+#define AVG_VOLUME_ALPHA			0.95	// Alpha of avgVolume's EMA for every AVG_VOLUME_ALPHA_SAMPLES samples (adjusted to the actual STFT frame rate)
+#define AVG_VOLUME_ALPHA_SAMPLES	1000
+#define AUDIO_BAND_SCALE_LOG		0		// Band edges are log-spaced between AUDIO_BAND_F_MIN and F_SAMPLING/2
+#define AUDIO_BAND_SCALE_MEL		1		// Band edges are equally spaced on the mel scale between AUDIO_BAND_F_MIN and F_SAMPLING/2
+#define AUDIO_BAND_SCALE			AUDIO_BAND_SCALE_LOG
+#define N_AUDIO_BANDS				4		// Number of frequency bands in AudioFrame::bands (with the defaults: bass <134Hz, low-mid <447Hz, mid <1.5kHz, treble). Too many bands leave the lowest ones without any bin
+#define AUDIO_BAND_F_MIN			40		// (Hz) Lower edge of the first band. Bins below it (DC, rumble) don't belong to any band (but still count towards the volume)
+#define AUDIO_BANDS_ALPHA			0.9		// Alpha of each band's EMA (AudioFrame::avgBands) for every AVG_VOLUME_ALPHA_SAMPLES samples
+
+
+/**********************      AudioFrame      **********************/
+struct AudioFrame {	// Result of analysing one STFT frame. Published by processAudio() and read-only for everybody else (LED effects, OLED, webSockets...)
+	uint32_t id;					// Sequence number of the frame (consumers can compare it to know if there's a new one)
+	uint32_t t;						// Time (ms, same reference as millis) at which the newest sample of the frame was taken
+	float volume;					// Sum of the magnitudes of all bins
+	float avgVolume;				// EMA of volume
+	float bands[N_AUDIO_BANDS];		// Sum of the magnitudes of the bins in each band (see audioBinBands)
+	float avgBands[N_AUDIO_BANDS];	// EMA of each band
+	float flux;						// Spectral flux of the bands (see BeatDetector)
+	bool onset;						// Whether an onset (attack) was detected on this frame
+	bool beat;						// Whether this frame falls on a beat (predicted from the tempo or an onset close enough to it)
+	float bpm;						// Estimated tempo (0 if unknown)
+	uint16_t beatPeriod;			// (ms) 60000/bpm (0 if unknown)
+	uint32_t tLastBeat;				// (ms) Time of the last beat, so effects can compute the beat phase at any time (see beatPhase)
+	float spectrum[N_FFT/2 + 1];	// |F(w)| of each frequency bin (0..F_SAMPLING/2)
+
+	float beatPhase(uint32_t tNow) const { return (beatPeriod == 0)? 0 : ((tNow - tLastBeat) % beatPeriod) / (float)beatPeriod; }	// Position in [0, 1) within the current beat at time tNow (ms), extrapolated from the tempo (0 if unknown)
+};
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+void setupAudio();	// Initializes the STFT parameters
+
+
+/***********************************************/
+/******      Audio related functions      ******/
+/***********************************************/
+void analyzeAudioFrame(AudioFrame& frame, const AudioFrame& prev, BeatDetector& detector, uint8_t nHops=1);	// Fills frame's spectrum, volume, bands, EMAs (continuing prev's, nHops ago) and beat info (from detector) from the current STFT window. Doesn't touch frame.id nor frame.t
+const AudioFrame& getAudioFrame();	// Returns the last published AudioFrame. Only valid until the next call to processAudio() (frames are double buffered)
+bool audioFrameReady();	// Returns whether adcRing holds enough new samples for processAudio() to compute a new frame (the scheduler's readiness predicate for the audio task)
+void processAudio();	// "Audio.loop()" function: slides the STFT window over every full hop of new samples in adcRing and publishes the analysis of the latest one
+
+#endif
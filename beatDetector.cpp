@@ -0,0 +1,144 @@
+/******      Beat detector      ******/
+#include "beatDetector.h"
+#include <string.h>
+
+
+/**********************      BeatDetector      **********************/
+void BeatDetector::reset() {	// Forgets all history (tempo, thresholds...)
+	onset = beat = false;
+	flux = bpm = 0;
+	beatPeriod = 0;
+	tLastBeat = tLastOnset = tNextBeat = 0;
+	memset(prevLogBands, 0, sizeof(prevLogBands));
+	memset(fluxHistory, 0, sizeof(fluxHistory));
+	fluxSum = fluxSumSq = 0;
+	fluxIdx = fluxCount = 0;
+	onsetIdx = onsetCount = 0;
+	memset(tempoHistogram, 0, sizeof(tempoHistogram));
+}
+
+void BeatDetector::process(const float* bands, uint8_t nBands, uint32_t t, uint8_t nHops) {	// Processes one frame of band energies taken at time t (ms), nHops after the previous one (>1 if frames were skipped). Constant time, except on onsets (O(BEAT_ONSET_HISTORY + BEAT_BPM_MAX-BEAT_BPM_MIN))
+	if (nBands > BEAT_MAX_BANDS) nBands = BEAT_MAX_BANDS;
+
+	flux = 0;	// Half-wave rectified difference of the log-compressed bands: only energy increases (attacks) count, and log makes it independent of the volume
+	for (uint8_t b=0; b<nBands; ++b) {
+		float logBand = logf(1 + bands[b]);
+		if (logBand > prevLogBands[b]) flux += logBand - prevLogBands[b];
+		prevLogBands[b] = logBand;
+	}
+
+	if (nHops > 1) {	// The flux across skipped frames adds up several hops of attacks: it isn't comparable to the history, so it can't be an onset. This frame just becomes the new baseline
+		flux = 0;
+		onset = false;
+	} else {
+		onset = detectOnset(t);
+	}
+	if (onset) {
+		updateTempo(t);
+		tLastOnset = t;
+	}
+	updateBeatGrid(t);
+}
+
+float BeatDetector::beatPhase(uint32_t t) const {	// Returns the position in [0, 1) within the current beat at time t (0 = on the beat), or 0 if the tempo is unknown
+	if (beatPeriod == 0) return 0;
+	return ((t - tLastBeat) % beatPeriod) / (float)beatPeriod;
+}
+
+bool BeatDetector::detectOnset(uint32_t t) {	// Updates the adaptive threshold with flux and returns whether it's an onset
+	bool isOnset = false;
+	if (fluxCount == BEAT_FLUX_HISTORY) {	// Don't detect anything until the history is full (threshold wouldn't be meaningful)
+		float mean = fluxSum/BEAT_FLUX_HISTORY, var = fluxSumSq/BEAT_FLUX_HISTORY - mean*mean;
+		float threshold = mean + BEAT_THRESHOLD_K*sqrtf((var > 0)? var : 0);
+		isOnset = (flux > threshold && flux > BEAT_MIN_FLUX && t-tLastOnset >= BEAT_MIN_IOI);
+	}
+
+	// Replace the oldest flux in the history
+	fluxSum += flux - fluxHistory[fluxIdx];
+	fluxSumSq += flux*flux - fluxHistory[fluxIdx]*fluxHistory[fluxIdx];
+	fluxHistory[fluxIdx] = flux;
+	if (++fluxIdx >= BEAT_FLUX_HISTORY) {
+		fluxIdx = 0;
+		fluxSum = fluxSumSq = 0;	// Recompute the running sums from scratch once per lap so float rounding errors don't accumulate
+		for (uint8_t i=0; i<BEAT_FLUX_HISTORY; ++i) {
+			fluxSum += fluxHistory[i];
+			fluxSumSq += fluxHistory[i]*fluxHistory[i];
+		}
+	}
+	if (fluxCount < BEAT_FLUX_HISTORY) ++fluxCount;
+
+	return isOnset;
+}
+
+void BeatDetector::updateTempo(uint32_t t) {	// Adds the intervals between the onset at t and the previous ones to the tempo histogram and updates bpm
+	const uint8_t N_TEMPO_BINS = BEAT_BPM_MAX - BEAT_BPM_MIN + 1;
+
+	for (uint8_t i=0; i<N_TEMPO_BINS; ++i) {
+		tempoHistogram[i] *= BEAT_TEMPO_DECAY;
+	}
+
+	for (uint8_t k=1; k<=onsetCount; ++k) {	// k-th most recent onset
+		uint32_t ioi = t - onsetTimes[(onsetIdx + BEAT_ONSET_HISTORY - k) % BEAT_ONSET_HISTORY];
+		if (ioi < BEAT_MIN_IOI) continue;
+		float candidate = 60000.0f/ioi;
+		while (candidate < BEAT_BPM_MIN) candidate *= 2;	// Fold the interval into the tempo range (eg: onsets every 2 beats, or on 8th notes)
+		while (candidate > BEAT_BPM_MAX) candidate /= 2;
+		uint8_t bin = (uint8_t)(candidate - BEAT_BPM_MIN + 0.5f);
+		float vote = 1.0f/k;	// Intervals to closer onsets are more reliable
+		tempoHistogram[bin] += vote;
+		if (bin > 0) tempoHistogram[bin-1] += vote/2;	// Spread the vote a bit so slightly different intervals reinforce each other
+		if (bin < N_TEMPO_BINS-1) tempoHistogram[bin+1] += vote/2;
+	}
+
+	onsetTimes[onsetIdx] = t;
+	onsetIdx = (onsetIdx + 1) % BEAT_ONSET_HISTORY;
+	if (onsetCount < BEAT_ONSET_HISTORY) ++onsetCount;
+
+	uint8_t best = 0;
+	for (uint8_t i=1; i<N_TEMPO_BINS; ++i) {
+		if (tempoHistogram[i] > tempoHistogram[best]) best = i;
+	}
+	if (tempoHistogram[best] >= 1) {	// Need at least a couple of consistent intervals before trusting the tempo
+		bpm = BEAT_BPM_MIN + best;
+		beatPeriod = 60000/(BEAT_BPM_MIN + best);
+	}
+}
+
+void BeatDetector::updateBeatGrid(uint32_t t) {	// Advances (or re-aligns, on onsets) the beat grid and sets beat
+	beat = false;
+	if (beatPeriod > 0 && t-tLastOnset > BEAT_TEMPO_TIMEOUT) {	// Music stopped (or lost track of it): forget the tempo
+		bpm = 0;
+		beatPeriod = 0;
+		memset(tempoHistogram, 0, sizeof(tempoHistogram));
+	}
+
+	if (beatPeriod == 0) {	// No tempo yet: every onset is a beat
+		if (onset) {
+			beat = true;
+			tLastBeat = t;
+		}
+		tNextBeat = t;
+		return;
+	}
+
+	const uint32_t tolerance = BEAT_PHASE_TOLERANCE*beatPeriod;
+	if (onset) {
+		if (t-tLastBeat <= tolerance) {		// Onset right after the beat we already emitted: just re-align the grid
+			tLastBeat = t;
+			tNextBeat = t + beatPeriod;
+		} else if ((int32_t)(tNextBeat-t) <= (int32_t)tolerance) {	// Onset slightly before the predicted beat: emit it now and re-align the grid
+			beat = true;
+			tLastBeat = t;
+			tNextBeat = t + beatPeriod;
+		}
+	}
+	if (!beat && (int32_t)(t-tNextBeat) >= 0) {	// Predicted beat (even if there was no onset)
+		beat = true;
+		tLastBeat = tNextBeat;
+		tNextBeat += beatPeriod;
+		if ((int32_t)(t-tNextBeat) >= 0) {	// Fell more than a period behind (eg: tempo just changed), restart the grid now
+			tLastBeat = t;
+			tNextBeat = t + beatPeriod;
+		}
+	}
+}
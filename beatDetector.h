@@ -0,0 +1,52 @@
+/******      Beat detector      ******/
+#ifndef BEAT_DETECTOR_H_
+#define BEAT_DETECTOR_H_
+
+#include <stdint.h>						// Plain C++ on purpose (no Arduino dependencies), so it can be fed recorded audio off-device
+#include <math.h>
+
+#define BEAT_MAX_BANDS			16		// Max number of bands process() accepts
+#define BEAT_FLUX_HISTORY		48		// Number of frames of spectral flux used for the adaptive threshold (~1.2s at 25.6ms/frame)
+#define BEAT_THRESHOLD_K		1.5		// An onset needs flux > mean + BEAT_THRESHOLD_K*stddev of the flux history
+#define BEAT_MIN_FLUX			0.3		// ...and flux > BEAT_MIN_FLUX, so noise during silence isn't detected as onsets
+#define BEAT_MIN_IOI			150		// (ms) Minimum Inter-Onset Interval
+#define BEAT_ONSET_HISTORY		8		// Number of previous onsets whose intervals to the newest one vote for the tempo
+#define BEAT_BPM_MIN			80		// Tempo range: intervals are folded (x2, /2) into [BEAT_BPM_MIN, BEAT_BPM_MAX]. Keep it to one octave, otherwise folding is ambiguous (eg: 60 vs 120 BPM)
+#define BEAT_BPM_MAX			(2*BEAT_BPM_MIN)
+#define BEAT_TEMPO_DECAY		0.9		// Every onset, the tempo histogram is multiplied by BEAT_TEMPO_DECAY before the new votes are added
+#define BEAT_PHASE_TOLERANCE	0.2		// Onsets within +-BEAT_PHASE_TOLERANCE periods of the predicted beat re-align the beat grid
+#define BEAT_TEMPO_TIMEOUT		4000	// (ms) Stop predicting beats if there hasn't been an onset in this long
+
+
+/**********************      BeatDetector      **********************/
+class BeatDetector {	// Onset detector (spectral flux over the band energies with an adaptive threshold) and tempo tracker (inter-onset interval histogram) with a beat grid effects can sync to
+public:
+	BeatDetector() { reset(); }
+
+	bool onset;				// Whether the last processed frame was an onset
+	bool beat;				// Whether a beat happened on the last processed frame (either predicted by the beat grid or an onset close enough to it)
+	float flux;				// Spectral flux of the last processed frame
+	float bpm;				// Estimated tempo (0 if unknown)
+	uint16_t beatPeriod;	// (ms) 60000/bpm (0 if unknown)
+	uint32_t tLastBeat;		// (ms) Time of the last beat
+	uint32_t tLastOnset;	// (ms) Time of the last onset
+
+	void reset();	// Forgets all history (tempo, thresholds...)
+	void process(const float* bands, uint8_t nBands, uint32_t t, uint8_t nHops=1);	// Processes one frame of band energies taken at time t (ms), nHops after the previous one (>1 if frames were skipped). Constant time, except on onsets (O(BEAT_ONSET_HISTORY + BEAT_BPM_MAX-BEAT_BPM_MIN))
+	float beatPhase(uint32_t t) const;	// Returns the position in [0, 1) within the current beat at time t (0 = on the beat), or 0 if the tempo is unknown
+
+protected:
+	float prevLogBands[BEAT_MAX_BANDS];
+	float fluxHistory[BEAT_FLUX_HISTORY], fluxSum, fluxSumSq;	// Circular buffer of the last flux values and their running sums (for the mean and stddev)
+	uint8_t fluxIdx, fluxCount;
+	uint32_t onsetTimes[BEAT_ONSET_HISTORY];	// Circular buffer of the last onset times
+	uint8_t onsetIdx, onsetCount;
+	float tempoHistogram[BEAT_BPM_MAX - BEAT_BPM_MIN + 1];	// Decaying votes for each integer BPM
+	uint32_t tNextBeat;		// (ms) Time the beat grid predicts the next beat at
+
+	bool detectOnset(uint32_t t);	// Updates the adaptive threshold with flux and returns whether it's an onset
+	void updateTempo(uint32_t t);	// Adds the intervals between the onset at t and the previous ones to the tempo histogram and updates bpm
+	void updateBeatGrid(uint32_t t);// Advances (or re-aligns, on onsets) the beat grid and sets beat
+};
+
+#endif
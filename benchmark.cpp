@@ -0,0 +1,113 @@
+/******      Benchmarks      ******/
+#include "benchmark.h"
+#include <new>							// std::nothrow (so running out of heap for the audio buffers doesn't reset the board)
+#include "audio.h"
+#include "ledStrip.h"
+
+bool benchmarkRequested = false;
+bool benchmarkFFTrequested = false;
+
+
+/**********************************************/
+/******      Benchmark related functions      ******/
+/**********************************************/
+template<typename F> uint32_t benchmarkCycles(uint16_t calls, F func) {	// Returns how many CPU cycles it took to call func() calls times
+	uint32_t cyclesStart = ESP.getCycleCount();
+	for (uint16_t n=0; n<calls; ++n) {
+		func();
+	}
+	return ESP.getCycleCount() - cyclesStart;
+}
+
+void benchmarkReport(Print& out, const char* bench, const String& variant, uint32_t calls, uint32_t cycles, uint16_t pixels=0) {	// Prints one result as a JSON object (ns per call, and per pixel if pixels>0)
+	uint64_t nsTotal = (uint64_t)cycles*1000/ESP.getCpuFreqMHz();
+	out.printf(CF("{\"bench\":\"%s\",\"variant\":\"%s\",\"calls\":%u,\"nsPerCall\":%u,\"nsPerPixel\":%u}\n"), bench, variant.c_str(), calls, (uint32_t)(nsTotal/calls), pixels? (uint32_t)(nsTotal/calls/pixels) : 0);
+	yield();	// Let the WiFi stack (and the watchdog) breathe between benchmarks
+}
+
+RgbColor wheelFormula(byte WheelPos) {	// Wheel as it used to be computed (before paletteRainbow), to compare against the lookup table
+	WheelPos = 255 - WheelPos;
+	if(WheelPos < 85) {
+		return RgbColor(255 - WheelPos * 3, 0, WheelPos * 3);
+	}
+	if(WheelPos < 170) {
+		WheelPos -= 85;
+		return RgbColor(0, WheelPos * 3, 255 - WheelPos * 3);
+	}
+	WheelPos -= 170;
+	return RgbColor(WheelPos * 3, 255 - WheelPos * 3, 0);
+}
+
+void benchmarkEffect(Print& out, LedStripEffect* effect) {	// Times BENCHMARK_CALLS iterations of effect (rendering into its frame only, see stripShow for the cost of presenting it)
+	effect->resetCounters();
+	uint32_t cycles = benchmarkCycles(BENCHMARK_CALLS, [effect]() { if (effect->step()) effect->resetCounters(); });
+	benchmarkReport(out, "effectFunc", effect->getCompressedEffectName(), BENCHMARK_CALLS, cycles, N_PIXELS);
+	delete effect;
+}
+
+void runBenchmarks(Print& out) {	// Runs the whole suite (FFT, audio analysis, every effect, Wheel/HSV/palettes, colorFull, output stage, strip.Show, effect JSON load/save and playlist load/save) and prints the results to out, one JSON object per line
+	out.printf(CF("{\"bench\":\"info\",\"cpuMHz\":%u,\"nPixels\":%u,\"nFFT\":%u,\"fftBackend\":\"%s\",\"stripMethod\":%u,\"freeHeap\":%u}\n"), ESP.getCpuFreqMHz(), N_PIXELS, N_FFT, (FFT_BACKEND == FFT_BACKEND_FIXED)? "fixed":"double", LED_STRIP_METHOD, ESP.getFreeHeap());
+
+	// Audio
+	std::unique_ptr<AudioFrame[]> frames(new (std::nothrow) AudioFrame[2]);	// Don't want to permanently reserve ~2KB of RAM just for benchmarking
+	std::unique_ptr<BeatDetector> detector(new (std::nothrow) BeatDetector());	// Own detector, so the live beat tracking isn't fed the same frame over and over
+	if (!frames || !detector) {
+		out.printf(CF("{\"bench\":\"error\",\"variant\":\"Not enough heap for the audio benchmarks\",\"freeHeap\":%u}\n"), ESP.getFreeHeap());
+	} else {
+		for (uint8_t window=0; window<=1; ++window) {
+			float* magn = frames[0].spectrum;
+			benchmarkReport(out, "computeFFT", window? "hamming":"noWindow", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, [magn, window]() { computeFFT(magn, window); }));
+		}
+		memset(frames.get(), 0, 2*sizeof(AudioFrame));
+		AudioFrame* f = frames.get();
+		BeatDetector* d = detector.get();
+		benchmarkReport(out, "analyzeAudioFrame", "fft+bands+ema+beat", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, [f, d]() { f[1].t += 26; analyzeAudioFrame(f[1], f[0], *d); }));
+	}
+
+	// LED strip
+	benchmarkEffect(out, new EffectColorWipe());
+	benchmarkEffect(out, new EffectRainbow());
+	benchmarkEffect(out, new EffectRainbowCycle());
+	benchmarkEffect(out, new EffectTheaterChase());
+	benchmarkEffect(out, new EffectTheaterChaseRainbow());
+	benchmarkEffect(out, new EffectVolumeShifter((uint32_t)-1));	// Never ends, otherwise it'd return right away if its deadline passed
+
+	static volatile uint8_t sink;	// So the compiler can't optimize Wheel away
+	benchmarkReport(out, "Wheel", "lut", 256*BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { for (uint16_t i=0; i<256; ++i) sink = Wheel(i).G; }));
+	benchmarkReport(out, "Wheel", "formula", 256*BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { for (uint16_t i=0; i<256; ++i) sink = wheelFormula(i).G; }));
+	benchmarkReport(out, "hsv", "hsvToRgb", 256*BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { for (uint16_t i=0; i<256; ++i) sink = hsvToRgb(i, 255, 255).G; }));
+	benchmarkReport(out, "hsv", "HsbColor", 256*BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { for (uint16_t i=0; i<256; ++i) sink = RgbColor(HsbColor(i/256.0f, 1, 1)).G; }));
+	benchmarkReport(out, "rainbowFill", "palette", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { paletteRainbow.fill(&stripFrame, sink); }), N_PIXELS);
+	benchmarkReport(out, "rainbowFill", "formula", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { for (uint16_t j=0; j<N_PIXELS; ++j) stripFrame.SetPixelColor(j, wheelFormula((sink+j) & 255)); }), N_PIXELS);
+	benchmarkReport(out, "colorFull", "", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { colorFull(RgbColor(sink, 0, 0)); }), N_PIXELS);
+	const bool dither = ledDither;
+	for (uint8_t d=0; d<=1; ++d) {
+		setLedOutput(ledBrightness, d);
+		benchmarkReport(out, "outputStage", d? "dither":"noDither", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { applyOutputStage(0, N_PIXELS); }), N_PIXELS);
+	}
+	setLedOutput(ledBrightness, dither);
+	benchmarkReport(out, "stripShow", "withWait", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { while (!strip.CanShow()) yield(); strip.Dirty(); strip.Show(); }), N_PIXELS);
+
+	// Effect configs
+	EffectTheaterChase effect;
+	benchmarkReport(out, "effectJSON", "save", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, [&effect]() { effect.saveConfigToFile(BENCHMARK_CONFIG_PATH); }));
+	benchmarkReport(out, "effectJSON", "load", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { delete LedStripEffect::fromJson(BENCHMARK_CONFIG_PATH); }));
+	SPIFFS.remove(BENCHMARK_CONFIG_PATH);
+	out.printf(CF("{\"bench\":\"configArena\",\"last\":%u,\"peak\":%u,\"size\":%u,\"heapLow\":%u,\"freeHeap\":%u}\n"), ConfigJson::arenaLast, ConfigJson::arenaPeak, CONFIG_ARENA_SIZE, ConfigJson::heapLow, ESP.getFreeHeap());
+
+	// Playlist (what boot loads)
+	benchmarkReport(out, "playlist", "save", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, []() { stripEffects.saveConfigToFile(BENCHMARK_PLAYLIST_PATH); }));
+	LedStripEffects playlist;
+	benchmarkReport(out, "playlist", "load", BENCHMARK_CALLS, benchmarkCycles(BENCHMARK_CALLS, [&playlist]() { playlist.loadConfigFromFile(BENCHMARK_PLAYLIST_PATH); }));
+	playlist.clear();
+	SPIFFS.remove(BENCHMARK_PLAYLIST_PATH);
+}
+
+void processBenchmark() {	// Runs the suite (or benchmarkFFT) through the console if benchmarkRequested (or benchmarkFFTrequested). Both take too long, and use fft_in and too much heap, to run from an async web server callback
+	if (!benchmarkRequested && !benchmarkFFTrequested) return;
+
+	ConsolePrint console;
+	if (benchmarkRequested) runBenchmarks(console);
+	if (benchmarkFFTrequested) benchmarkFFT(console);
+	benchmarkRequested = benchmarkFFTrequested = false;
+}
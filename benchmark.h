@@ -0,0 +1,21 @@
+/******      Benchmarks      ******/
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "main.h"						// Global includes and definitions
+
+#define BENCHMARK_CALLS			20				// Number of calls each benchmark is averaged over
+#define BENCHMARK_CONFIG_PATH	"/bench.json"	// Temporary SPIFFS file for the JSON load/save benchmarks
+#define BENCHMARK_PLAYLIST_PATH	"/bench.bin"	// Temporary SPIFFS file for the playlist load/save benchmarks
+
+extern bool benchmarkRequested;	// Set it to run the suite from the main loop (see processBenchmark), output goes to the console
+extern bool benchmarkFFTrequested;	// Same, but only benchmarkFFT
+
+
+/**********************************************/
+/******      Benchmark related functions      ******/
+/**********************************************/
+void runBenchmarks(Print& out);	// Runs the whole suite (FFT, audio analysis, every effect, Wheel/HSV/palettes, colorFull, output stage, strip.Show, effect JSON load/save and playlist load/save) and prints the results to out, one JSON object per line
+void processBenchmark();		// Runs the suite (or benchmarkFFT) through the console if benchmarkRequested (or benchmarkFFTrequested). Both take too long, and use fft_in and too much heap, to run from an async web server callback
+
+#endif
@@ -1,5 +1,6 @@
 /******      File IO helpers      ******/
 #include "fileIO.h"
+#include <new>							// Placement new (to reset the ConfigJson arena)
 
 
 /***************************************************/
@@ -17,34 +18,103 @@ void setupFileIO() {	// Initializes file system, so we can read/write config and
 /*************************************************/
 /******      File IO related functions      ******/
 /*************************************************/
-std::unique_ptr<char[]> readFile(String filePath) {	// Reads the contents of a file and returns a pointer to a dynamically allocated char[] buffer. Pointer will evaluate to NULL on fail.
+bool replaceFile(String tmpPath, String filePath) {	// Makes tmpPath (already written and closed) the new filePath. SPIFFS can't rename over an existing file, so filePath is removed first: if power is lost right then, recoverFile finishes the job on the next boot
+	if (SPIFFS.exists(filePath) && !SPIFFS.remove(filePath)) {
+		consolePrintF("Failed to remove old SPIFFS file %s :(\n", filePath.c_str());
+		return false;
+	}
+	if (!SPIFFS.rename(tmpPath, filePath)) {
+		consolePrintF("Failed to rename SPIFFS file %s to %s :(\n", tmpPath.c_str(), filePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+void recoverFile(String filePath) {	// If filePath is missing but filePath + FILE_TMP_SUFFIX exists (see replaceFile), renames the latter
+	const String tmpPath = filePath + FILE_TMP_SUFFIX;
+	if (!SPIFFS.exists(filePath) && SPIFFS.exists(tmpPath)) {	// (A tmp file next to an existing filePath is just a write that didn't finish, it'll be overwritten next time)
+		consolePrintF("Recovering SPIFFS file %s from %s\n", filePath.c_str(), tmpPath.c_str());
+		SPIFFS.rename(tmpPath, filePath);
+	}
+}
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {	// CRC-32 (same as zlib's crc32) of data, continuing from crc (start with crc=0)
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+	while (len--) {	// Bitwise (no table): files are small and it saves 1KB of RAM
+		crc ^= *p++;
+		for (uint8_t b=0; b<8; ++b) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+
+/**********************      ConfigJson      **********************/
+size_t ConfigJson::arenaLast = 0;
+size_t ConfigJson::arenaPeak = 0;
+uint32_t ConfigJson::heapLow = UINT32_MAX;
+uint32_t ConfigJson::arenaStorage[(sizeof(ConfigJson::Arena) + 3)/4];
+bool ConfigJson::inUse = false;
+
+ConfigJson::ConfigJson() : owner(!inUse) {
+	if (!owner) {
+		consolePrintF("ConfigJson arena already in use :(\n");
+		return;
+	}
+	inUse = true;
+	new (arenaStorage) Arena();	// Start from an empty arena
+}
+
+ConfigJson::~ConfigJson() {	// Updates the arena usage stats
+	if (!owner) return;
+	arenaLast = arena().size();
+	if (arenaLast > arenaPeak) arenaPeak = arenaLast;
+	arena().~Arena();
+	inUse = false;
+}
+
+JsonObject& ConfigJson::load(String filePath) {	// Parses filePath (check success() on the result, errors are printed to the console)
+	if (!owner) return JsonObject::invalid();
 	File f = SPIFFS.open(filePath, "r");
 	if (!f) {
 		consolePrintF("Failed to open SPIFFS file %s :(\n", filePath.c_str());
-		return std::unique_ptr<char[]>{};
+		return JsonObject::invalid();
 	}
-	
-	size_t size = f.size();
-	if (size > 2048) {
-		consolePrintF("SPIFFS file %s is too large (%d B), can't open :(\n", filePath.c_str(), size);
-		return std::unique_ptr<char[]>{};
-	}
-	
-	std::unique_ptr<char[]> buf(new char[size]);	// Allocate a buffer to store contents of the file. unique_ptr ensures delete[] gets called when the buffer gets out of scope :)
-	f.readBytes(buf.get(), size);	// ArduinoJson library requires the input buffer to be mutable, so we gotta use char[] instead of String
-	consolePrintF("Successfully read SPIFFS file %s!\n", filePath.c_str());
-	return buf;
+
+	JsonObject& json = arena().parseObject(f);	// Reads the File (a Stream) as it parses, copying only the strings into the arena
+	heapLow = min(heapLow, ESP.getFreeHeap());
+	if (!json.success()) consolePrintF("Failed to parse JSON config file %s (%u B, arena: %u/%u B) :(\n", filePath.c_str(), f.size(), arena().size(), CONFIG_ARENA_SIZE);
+	return json;
+}
+
+JsonObject& ConfigJson::parse(char* json) {	// Parses json in place (it gets modified, and strings in the result point into it)
+	if (!owner) return JsonObject::invalid();
+	return arena().parseObject(json);
 }
 
-bool saveJSON(JsonObject& json, String filePath) {	// Saves the contents of a json buffer to a file, and returns whether we succeeded or not
-	File f = SPIFFS.open(filePath, "w");
+JsonObject& ConfigJson::create() {	// New empty object (to fill in and save)
+	if (!owner) return JsonObject::invalid();
+	return arena().createObject();
+}
+
+bool ConfigJson::save(JsonObject& json, String filePath) {	// Writes json to filePath (through a temp file, see replaceFile)
+	const String tmpPath = filePath + FILE_TMP_SUFFIX;
+	File f = SPIFFS.open(tmpPath, "w");
 	if (!f) {
 		consolePrintF("Failed to save JSON file %s :(\n", filePath.c_str());
 		return false;
 	}
-	
-	json.printTo(f);
-	consolePrintF("Successfully saved JSON file %s!\n", filePath.c_str());
-	return true;
-}
 
+	const size_t len = json.measureLength();
+	const bool written = (json.printTo(f) == len);
+	heapLow = min(heapLow, ESP.getFreeHeap());
+	f.close();
+	if (!written) {
+		consolePrintF("Failed to write JSON file %s (flash full?) :(\n", filePath.c_str());
+		SPIFFS.remove(tmpPath);
+		return false;
+	}
+	return replaceFile(tmpPath, filePath);
+}
@@ -6,7 +6,8 @@
 #include <FS.h>							// SPIFFS file system (to read/write to flash)
 #include <ArduinoJson.h>				// JSON parser library (to load/save settings, read files for the web server, etc)
 
-#define JSON_BUFFER_SIZE		512
+#define CONFIG_ARENA_SIZE		1024	// (B) Static arena config JSON documents are parsed into / built in (including their strings, which get copied out of the File stream)
+#define FILE_TMP_SUFFIX			".tmp"	// Files are written as filePath + FILE_TMP_SUFFIX first, then renamed (see replaceFile)
 
 
 /***************************************************/
@@ -18,8 +19,49 @@ void setupFileIO();	// Initializes file system, so we can read/write config and
 /*************************************************/
 /******      File IO related functions      ******/
 /*************************************************/
-std::unique_ptr<char[]> readFile(String filePath);	// Reads the contents of a file and returns a pointer to a dynamically allocated char[] buffer. Pointer will evaluate to NULL on fail.
-bool saveJSON(JsonObject& json, String filePath);	// Saves the contents of a json buffer to a file, and returns whether we succeeded or not
+bool replaceFile(String tmpPath, String filePath);	// Makes tmpPath (already written and closed) the new filePath. SPIFFS can't rename over an existing file, so filePath is removed first: if power is lost right then, recoverFile finishes the job on the next boot
+void recoverFile(String filePath);	// If filePath is missing but filePath + FILE_TMP_SUFFIX exists (see replaceFile), renames the latter
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len);	// CRC-32 (same as zlib's crc32) of data, continuing from crc (start with crc=0)
+
+/**********************      CrcFile      **********************/
+class CrcFile {	// Wraps a File (or any other Stream) so every byte read or written also goes into a CRC-32 (to checksum binary files)
+public:
+	CrcFile(Stream& f) : crc(0), f(f) {}
+
+	uint32_t crc;	// CRC-32 of everything read/written so far
+
+	bool read(void* data, size_t len) { if (f.readBytes((char*)data, len) != len) return false; crc = crc32Update(crc, data, len); return true; }
+	bool write(const void* data, size_t len) { crc = crc32Update(crc, data, len); return f.write((const uint8_t*)data, len) == len; }
+	template<typename T> bool read(T& value) { return read(&value, sizeof(value)); }
+	template<typename T> bool write(const T& value) { return write(&value, sizeof(value)); }
+
+protected:
+	Stream& f;
+};
+
+/**********************      ConfigJson      **********************/
+class ConfigJson {	// Scoped access to the single static arena config JSON is parsed into (straight from the SPIFFS File stream, so no heap buffer and no file size cap) or built in before saving. Only one can be alive at a time
+public:
+	ConfigJson();
+	~ConfigJson();	// Updates the arena usage stats
+
+	JsonObject& load(String filePath);	// Parses filePath (check success() on the result, errors are printed to the console)
+	JsonObject& parse(char* json);		// Parses json in place (it gets modified, and strings in the result point into it)
+	JsonObject& create();				// New empty object (to fill in and save)
+	bool save(JsonObject& json, String filePath);	// Writes json to filePath (through a temp file, see replaceFile)
+
+	static size_t arenaLast;	// (B) Arena used by the last ConfigJson
+	static size_t arenaPeak;	// (B) Most arena ever used by a ConfigJson
+	static uint32_t heapLow;	// (B) Lowest free heap seen while loading/saving config (should stay put now that nothing gets allocated per file)
+
+protected:
+	typedef StaticJsonBuffer<CONFIG_ARENA_SIZE> Arena;
+	static Arena& arena() { return *reinterpret_cast<Arena*>(arenaStorage); }
+	static uint32_t arenaStorage[(sizeof(Arena) + 3)/4];	// (uint32_t for alignment) Reset with a placement new by every ConfigJson
+	static bool inUse;
+
+	bool owner;	// False if another ConfigJson was alive already (every load/create then fails)
+};
 
 #endif
 
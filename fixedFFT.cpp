@@ -0,0 +1,164 @@
+/******      Fixed-point FFT      ******/
+#include "fixedFFT.h"
+
+#define FIXED_FFT_SCALE_MASK	0xE000	// If any |re| or |im| has any of these bits set (>=2^13), the next stage is scaled by 1/2 so the butterflies can't overflow
+
+const int16_t PROGMEM fixedFFTsinTable[FIXED_FFT_N_MAX/4 + 1] = {	// Quarter-wave sine table: round(32767*sin(2*pi*k/FIXED_FFT_N_MAX)), k=0..FIXED_FFT_N_MAX/4
+	     0,    402,    804,   1206,   1608,   2009,   2410,   2811,   3212,   3612,   4011,   4410,   4808,   5205,   5602,   5998,
+	  6393,   6786,   7179,   7571,   7962,   8351,   8739,   9126,   9512,   9896,  10278,  10659,  11039,  11417,  11793,  12167,
+	 12539,  12910,  13279,  13645,  14010,  14372,  14732,  15090,  15446,  15800,  16151,  16499,  16846,  17189,  17530,  17869,
+	 18204,  18537,  18868,  19195,  19519,  19841,  20159,  20475,  20787,  21096,  21403,  21705,  22005,  22301,  22594,  22884,
+	 23170,  23452,  23731,  24007,  24279,  24547,  24811,  25072,  25329,  25582,  25832,  26077,  26319,  26556,  26790,  27019,
+	 27245,  27466,  27683,  27896,  28105,  28310,  28510,  28706,  28898,  29085,  29268,  29447,  29621,  29791,  29956,  30117,
+	 30273,  30424,  30571,  30714,  30852,  30985,  31113,  31237,  31356,  31470,  31580,  31685,  31785,  31880,  31971,  32057,
+	 32137,  32213,  32285,  32351,  32412,  32469,  32521,  32567,  32609,  32646,  32678,  32705,  32728,  32745,  32757,  32765,
+	 32767};
+
+const int16_t PROGMEM fixedFFThammingTable[FIXED_FFT_N_MAX/2] = {	// First half of a symmetric Hamming window: round(32767*(0.54 - 0.46*cos(2*pi*n/(FIXED_FFT_N_MAX-1)))), same definition as arduinoFFT
+	  2621,   2622,   2626,   2632,   2640,   2650,   2662,   2677,   2694,   2714,   2735,   2759,   2785,   2814,   2844,   2877,
+	  2912,   2949,   2989,   3031,   3075,   3121,   3169,   3220,   3273,   3328,   3385,   3444,   3506,   3569,   3635,   3703,
+	  3773,   3845,   3919,   3996,   4074,   4155,   4237,   4321,   4408,   4496,   4587,   4680,   4774,   4870,   4969,   5069,
+	  5171,   5275,   5381,   5489,   5599,   5710,   5824,   5939,   6056,   6174,   6295,   6417,   6541,   6666,   6793,   6922,
+	  7052,   7185,   7318,   7453,   7590,   7728,   7868,   8010,   8152,   8296,   8442,   8589,   8737,   8887,   9038,   9191,
+	  9344,   9499,   9655,   9813,   9971,  10131,  10292,  10454,  10617,  10781,  10946,  11113,  11280,  11448,  11617,  11787,
+	 11958,  12130,  12303,  12476,  12650,  12825,  13001,  13178,  13355,  13533,  13711,  13890,  14070,  14250,  14431,  14612,
+	 14793,  14975,  15158,  15341,  15524,  15708,  15892,  16076,  16260,  16445,  16629,  16814,  16999,  17185,  17370,  17555,
+	 17741,  17926,  18111,  18296,  18481,  18667,  18851,  19036,  19221,  19405,  19589,  19773,  19956,  20139,  20322,  20504,
+	 20686,  20867,  21048,  21229,  21409,  21588,  21767,  21945,  22122,  22299,  22475,  22651,  22825,  22999,  23172,  23344,
+	 23516,  23686,  23856,  24025,  24192,  24359,  24525,  24689,  24853,  25016,  25177,  25337,  25496,  25654,  25811,  25967,
+	 26121,  26274,  26426,  26576,  26725,  26873,  27019,  27164,  27308,  27450,  27590,  27729,  27867,  28003,  28137,  28270,
+	 28401,  28531,  28659,  28785,  28910,  29033,  29154,  29274,  29391,  29507,  29622,  29734,  29845,  29953,  30060,  30165,
+	 30268,  30370,  30469,  30566,  30662,  30755,  30847,  30936,  31024,  31109,  31193,  31274,  31354,  31431,  31506,  31579,
+	 31650,  31719,  31786,  31851,  31913,  31974,  32032,  32088,  32142,  32194,  32243,  32291,  32336,  32379,  32419,  32458,
+	 32494,  32528,  32560,  32589,  32617,  32642,  32664,  32685,  32703,  32719,  32733,  32744,  32753,  32760,  32764,  32767};
+
+
+/******************************************************/
+/******      Fixed-point FFT related functions      ******/
+/******************************************************/
+static inline int16_t twiddleSin(uint16_t k) {	// sin(2*pi*k/FIXED_FFT_N_MAX) in Q15, for k in [0, FIXED_FFT_N_MAX/2)
+	return (k <= FIXED_FFT_N_MAX/4)? pgm_read_word(&fixedFFTsinTable[k]) : pgm_read_word(&fixedFFTsinTable[FIXED_FFT_N_MAX/2 - k]);
+}
+
+static inline int16_t twiddleCos(uint16_t k) {	// cos(2*pi*k/FIXED_FFT_N_MAX) in Q15, for k in [0, FIXED_FFT_N_MAX/2)
+	return (k <= FIXED_FFT_N_MAX/4)? pgm_read_word(&fixedFFTsinTable[FIXED_FFT_N_MAX/4 - k]) : -(int16_t)pgm_read_word(&fixedFFTsinTable[k - FIXED_FFT_N_MAX/4]);
+}
+
+int8_t fixedFFTnormalize(int16_t* x, uint16_t n) {	// Shifts x left (or right) so that max|x| uses FIXED_FFT_HEADROOM bits. Returns the number of left shifts applied (negative if right)
+	uint16_t peak = 0;	// OR of all |x[i]| has the same highest set bit as max|x[i]|
+	for (uint16_t i=0; i<n; ++i) {
+		peak |= (x[i]<0)? -x[i] : x[i];
+	}
+	if (peak == 0) return 0;
+
+	int8_t shift = 0;
+	while (peak < (1<<(FIXED_FFT_HEADROOM-1))) { peak <<= 1; ++shift; }
+	while (peak >= (1<<FIXED_FFT_HEADROOM)) { peak >>= 1; --shift; }
+
+	if (shift > 0) {
+		for (uint16_t i=0; i<n; ++i) x[i] *= (1<<shift);	// (Not <<=: left-shifting a negative value is undefined before C++20. Compiles to the same shift)
+	} else if (shift < 0) {
+		for (uint16_t i=0; i<n; ++i) x[i] >>= -shift;
+	}
+	return shift;
+}
+
+void fixedFFTwindowHamming(int16_t* x) {	// Applies a (Q15, precomputed) Hamming window to the FIXED_FFT_N_MAX samples in x
+	for (uint16_t i=0; i<FIXED_FFT_N_MAX/2; ++i) {
+		int32_t w = (int16_t)pgm_read_word(&fixedFFThammingTable[i]);
+		x[i] = (x[i]*w + (1<<14)) >> 15;
+		x[FIXED_FFT_N_MAX-1-i] = (x[FIXED_FFT_N_MAX-1-i]*w + (1<<14)) >> 15;
+	}
+}
+
+uint8_t fixedFFT(int16_t* z, uint16_t n) {	// In-place Q15 complex radix-2 DIT FFT (z holds n interleaved re,im pairs) with block floating point scaling. Returns the exponent e such that Z[k] = (z[2k] + j*z[2k+1]) * 2^e
+	// Bit-reversal permutation
+	for (uint16_t i=1, j=0; i<n; ++i) {
+		uint16_t bit = n>>1;
+		for (; j&bit; bit>>=1) j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			int16_t tmp = z[2*i]; z[2*i] = z[2*j]; z[2*j] = tmp;
+			tmp = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = tmp;
+		}
+	}
+
+	uint16_t peak = 0;	// OR of every |re| and |im| of the previous stage, decides whether the next stage needs to be scaled
+	for (uint16_t i=0; i<2*n; ++i) {
+		peak |= (z[i]<0)? -z[i] : z[i];
+	}
+
+	uint8_t exponent = 0;
+	for (uint16_t m=1; m<n; m<<=1) {	// m is half the span of the butterflies in this stage
+		uint8_t shift = 15;				// Butterflies are computed in Q30 and brought back to Q15 (or Q15/2 if the stage is scaled)
+		if (peak & FIXED_FFT_SCALE_MASK) {
+			++shift;
+			++exponent;
+		}
+		const int32_t round = 1L<<(shift-1);
+		const uint16_t stride = FIXED_FFT_N_MAX/(2*m);
+		peak = 0;
+
+		for (uint16_t k=0; k<m; ++k) {
+			const int32_t c = twiddleCos(k*stride), s = twiddleSin(k*stride);	// W = c - j*s
+			for (uint16_t i=2*k; i<2*n; i+=4*m) {
+				const uint16_t j = i + 2*m;
+				const int32_t tr = c*z[j] + s*z[j+1], ti = c*z[j+1] - s*z[j];	// t = W*z[j] (Q30)
+				const int32_t ar = (int32_t)z[i]*32768, ai = (int32_t)z[i+1]*32768;	// (Q30. Not << 15: left-shifting a negative value is undefined before C++20)
+				z[i]   = (ar + tr + round) >> shift;
+				z[i+1] = (ai + ti + round) >> shift;
+				z[j]   = (ar - tr + round) >> shift;
+				z[j+1] = (ai - ti + round) >> shift;
+				peak |= ((z[i]<0)? -z[i] : z[i]) | ((z[i+1]<0)? -z[i+1] : z[i+1]) | ((z[j]<0)? -z[j] : z[j]) | ((z[j+1]<0)? -z[j+1] : z[j+1]);
+			}
+		}
+	}
+
+	return exponent;
+}
+
+uint8_t fixedRealFFT(int16_t* x, uint16_t n) {	// In-place FFT of n real samples, computed as an n/2-point complex FFT of z[m] = x[2m] + j*x[2m+1]. Returns the exponent of Z (see fixedRealFFTmagnitude)
+	return fixedFFT(x, n/2);	// Even/odd samples already sit where fixedFFT expects the real/imaginary parts, no packing needed
+}
+
+static inline uint32_t magnitude(int32_t xr, int32_t xi) {	// |xr + j*xi|. |X| can reach 2^15*2*sqrt(2), so the squares are summed in 64 bits and shifted back into isqrt32's range when needed
+	uint64_t sum = (uint64_t)((int64_t)xr*xr) + (uint64_t)((int64_t)xi*xi);
+	uint8_t shift = 0;
+	while (sum >> 32) {
+		sum >>= 2;
+		++shift;
+	}
+	return (uint32_t)isqrt32(sum) << shift;
+}
+
+void fixedRealFFTmagnitude(const int16_t* z, uint16_t n, float scale, float* magn) {	// Split step of fixedRealFFT: fills magn[0..n/2] with scale*|X[k]| from the n/2 complex bins Z in z
+	// With A = Z[k] and B = Z[n/2-k]: E = (A + B*)/2, O = (A - B*)/(2j), X[k] = E + W^k*O and |X[n/2-k]| = |E - W^k*O| (W = e^(-j*2*pi/n))
+	const uint16_t h = n/2, stride = FIXED_FFT_N_MAX/n;
+	for (uint16_t k=0; k<=h/2; ++k) {
+		const uint16_t kc = (k==0)? 0 : h-k;	// Z is periodic, so Z[n/2] = Z[0]
+		const int32_t ar = z[2*k], ai = z[2*k+1], br = z[2*kc], bi = z[2*kc+1];
+		const int32_t er = ar + br, ei = ai - bi, or_ = ai + bi, oi = br - ar;	// 2E and 2O (so no precision is lost)
+		const int32_t c = twiddleCos(k*stride), s = twiddleSin(k*stride);
+		const int32_t wr = (c*or_ + s*oi + (1L<<14)) >> 15, wi = (c*oi - s*or_ + (1L<<14)) >> 15;	// 2*W^k*O
+		int32_t xr = (er + wr + 1) >> 1, xi = (ei + wi + 1) >> 1;	// X = (2E + 2W^k*O)/2
+		magn[k] = scale * magnitude(xr, xi);
+		xr = (er - wr + 1) >> 1;
+		xi = (ei - wi + 1) >> 1;
+		magn[h-k] = scale * magnitude(xr, xi);
+	}
+}
+
+uint16_t isqrt32(uint32_t x) {	// Integer square root (floor) of a 32-bit number
+	uint32_t res = 0, bit = 1UL<<30;
+	while (bit > x) bit >>= 2;
+	while (bit) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res>>1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
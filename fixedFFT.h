@@ -0,0 +1,22 @@
+/******      Fixed-point FFT      ******/
+#ifndef FIXED_FFT_H_
+#define FIXED_FFT_H_
+
+#include <Arduino.h>					// PROGMEM, pgm_read_word and fixed-width integer types
+
+#define FIXED_FFT_N_MAX			512		// Twiddle and Hamming tables are precomputed for this size (smaller power-of-2 transforms reuse the twiddles with a stride)
+#define FIXED_FFT_LOG2_N_MAX	9
+#define FIXED_FFT_HEADROOM		14		// Inputs are normalized so that |x| < 2^FIXED_FFT_HEADROOM, leaving 1 bit of headroom for the first butterflies
+
+
+/******************************************************/
+/******      Fixed-point FFT related functions      ******/
+/******************************************************/
+int8_t fixedFFTnormalize(int16_t* x, uint16_t n);		// Shifts x left (or right) so that max|x| uses FIXED_FFT_HEADROOM bits. Returns the number of left shifts applied (negative if right)
+void fixedFFTwindowHamming(int16_t* x);					// Applies a (Q15, precomputed) Hamming window to the FIXED_FFT_N_MAX samples in x
+uint8_t fixedFFT(int16_t* z, uint16_t n);				// In-place Q15 complex radix-2 DIT FFT (z holds n interleaved re,im pairs) with block floating point scaling. Returns the exponent e such that Z[k] = (z[2k] + j*z[2k+1]) * 2^e
+uint8_t fixedRealFFT(int16_t* x, uint16_t n);			// In-place FFT of n real samples, computed as an n/2-point complex FFT of z[m] = x[2m] + j*x[2m+1]. Returns the exponent of Z (see fixedRealFFTmagnitude)
+void fixedRealFFTmagnitude(const int16_t* z, uint16_t n, float scale, float* magn);	// Split step of fixedRealFFT: fills magn[0..n/2] with scale*|X[k]| from the n/2 complex bins Z in z
+uint16_t isqrt32(uint32_t x);							// Integer square root (floor) of a 32-bit number
+
+#endif
@@ -0,0 +1,193 @@
+/******      Host shim: Arduino core      ******/
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "hostSupport.h"				// Virtual clock, timer1 and interrupt emulation
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define PSTR(s)					(s)
+#define F(s)					(reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(p)				(reinterpret_cast<const __FlashStringHelper*>(p))
+#define pgm_read_byte(addr)		(*(const uint8_t*)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t*)(addr))
+#define pgm_read_dword(addr)	(*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr)		(*(void* const*)(addr))
+#define strcmp_P				strcmp
+#define strncmp_P				strncmp
+#define memcpy_P				memcpy
+#define constrain(x, lo, hi)	((x)<(lo)? (lo) : (x)>(hi)? (hi) : (x))
+#define PI						3.1415926535897932384626433832795
+#define LOW						0
+#define HIGH					1
+#define INPUT					0
+#define OUTPUT					1
+#define LED_BUILTIN				2
+#define MSBFIRST				1
+
+typedef uint8_t byte;
+typedef bool boolean;
+class __FlashStringHelper;
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {	// (glibc only has it since 2.38)
+	const size_t len = strlen(src);
+	if (size > 0) {
+		const size_t n = (len < size-1)? len : size-1;
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return len;
+}
+#endif
+
+
+/**********************      String      **********************/
+class String {	// Arduino's String on top of std::string (only what the sketch uses)
+public:
+	String() {}
+	String(const char* s) : s(s? s : "") {}
+	explicit String(const std::string& s) : s(s) {}
+	String(const __FlashStringHelper* s) : s(reinterpret_cast<const char*>(s)) {}
+	explicit String(char c) : s(1, c) {}
+	explicit String(unsigned char v) : s(std::to_string(v)) {}
+	explicit String(int v) : s(std::to_string(v)) {}
+	explicit String(unsigned int v) : s(std::to_string(v)) {}
+	explicit String(long v) : s(std::to_string(v)) {}
+	explicit String(unsigned long v) : s(std::to_string(v)) {}
+	explicit String(float v, unsigned char decimals=2) { char buf[32]; snprintf(buf, sizeof(buf), "%.*f", decimals, v); s = buf; }
+	explicit String(double v, unsigned char decimals=2) { char buf[32]; snprintf(buf, sizeof(buf), "%.*f", decimals, v); s = buf; }
+
+	const char* c_str() const { return s.c_str(); }
+	unsigned int length() const { return s.length(); }
+	char operator[](unsigned int i) const { return (i < s.length())? s[i] : '\0'; }
+	bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+	bool endsWith(const String& suffix) const { return s.length() >= suffix.s.length() && s.compare(s.length()-suffix.s.length(), suffix.s.length(), suffix.s) == 0; }
+	int indexOf(char c) const { size_t i = s.find(c); return (i == std::string::npos)? -1 : i; }
+	String substring(unsigned int from, unsigned int to=(unsigned int)-1) const { return (from < s.length())? String(s.substr(from, to-from)) : String(); }
+	long toInt() const { return atol(s.c_str()); }
+	bool operator==(const String& o) const { return s == o.s; }
+	bool operator!=(const String& o) const { return s != o.s; }
+	bool operator==(const char* o) const { return s == o; }
+	bool operator!=(const char* o) const { return s != o; }
+
+	String& operator+=(const String& o) { s += o.s; return *this; }
+	String& operator+=(const char* o) { s += o; return *this; }
+	String& operator+=(const __FlashStringHelper* o) { s += reinterpret_cast<const char*>(o); return *this; }
+	String& operator+=(char c) { s += c; return *this; }
+	String& operator+=(unsigned char v) { return *this += String(v); }
+	String& operator+=(int v) { return *this += String(v); }
+	String& operator+=(unsigned int v) { return *this += String(v); }
+	String& operator+=(long v) { return *this += String(v); }
+	String& operator+=(unsigned long v) { return *this += String(v); }
+	String& operator+=(float v) { return *this += String(v); }
+	String& operator+=(double v) { return *this += String(v); }
+
+protected:
+	std::string s;
+};
+template<typename T> String operator+(const String& a, const T& b) { String sum(a); sum += b; return sum; }
+inline String operator+(const char* a, const String& b) { String sum(a); sum += b; return sum; }
+
+
+/**********************      Print and Stream      **********************/
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buf, size_t len) { size_t n = 0; while (len-- && write(*buf++)) ++n; return n; }
+	size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+	size_t print(const char* str) { return write(str); }
+	size_t print(const String& str) { return write(str.c_str()); }
+	size_t println(const char* str="") { return write(str) + write((uint8_t)'\n'); }
+	size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+		char buf[1024];
+		va_list args;
+		va_start(args, format);
+		int len = vsnprintf(buf, sizeof(buf), format, args);
+		va_end(args);
+		return write((const uint8_t*)buf, min(len, (int)sizeof(buf)-1));
+	}
+	virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual size_t readBytes(char* buf, size_t len) {	// (No timeout: a host stream that runs out is done)
+		size_t n = 0;
+		for (int c; n < len && (c = read()) >= 0; ++n) buf[n] = c;
+		return n;
+	}
+	size_t readBytes(uint8_t* buf, size_t len) { return readBytes((char*)buf, len); }
+};
+
+class HardwareSerial : public Stream {	// Serial goes to stdout
+public:
+	void begin(unsigned long baud) {}
+	void setDebugOutput(bool on) {}
+	operator bool() const { return true; }
+	size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+	size_t write(const uint8_t* buf, size_t len) { return fwrite(buf, 1, len, stdout); }
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+};
+extern HardwareSerial Serial;
+
+
+/**********************      ESP      **********************/
+class EspClass {	// Cycles are host nanoseconds (getCpuFreqMHz returns 1000), so cycles*1000/getCpuFreqMHz() is still ns
+public:
+	uint32_t getCycleCount() { return hostNanos(); }
+	uint32_t getCpuFreqMHz() { return 1000; }
+	uint32_t getFreeHeap() { return 40000; }	// (The host can't run out, report what the board usually has left)
+	uint32_t getChipId() { return 0x123456; }
+	void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+
+/**********************      Core functions      **********************/
+inline uint32_t millis() { return hostMillis(); }
+inline uint32_t micros() { return hostMicros(); }
+inline void delay(uint32_t ms) { hostSleepMicros(ms*1000); }
+inline void delayMicroseconds(uint32_t us) { hostSleepMicros(us); }
+inline void yield() { hostSleepMicros(0); }
+inline uint32_t clockCyclesPerMicrosecond() { return 160; }	// (The sketch runs the CPU at 160MHz, timer1 still counts at 80MHz)
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+inline int digitalRead(uint8_t pin) { return LOW; }
+inline void analogWrite(uint8_t pin, int val) {}
+inline void analogWriteRange(uint32_t range) {}
+
+#define TIM_DIV1	0
+#define TIM_DIV16	1
+#define TIM_DIV256	3
+#define TIM_EDGE	0
+#define TIM_LEVEL	1
+#define TIM_SINGLE	0
+#define TIM_LOOP	1
+typedef void (*timercallback)();
+inline void timer1_isr_init() {}
+inline void timer1_attachInterrupt(timercallback isr) { hostTimerAttach(isr); }
+inline void timer1_detachInterrupt() { hostTimerAttach(NULL); }
+inline void timer1_enable(uint8_t divider, uint8_t intType, uint8_t reload) { hostTimerEnable(divider == TIM_DIV16? 16 : divider == TIM_DIV256? 256 : 1); }
+inline void timer1_disable() { hostTimerEnable(0); }
+inline void timer1_write(uint32_t ticks) { hostTimerWrite(ticks); }
+
+#endif
@@ -0,0 +1,189 @@
+/******      Host shim: ArduinoJson (v5)      ******/
+#include "ArduinoJson.h"
+
+#define JSON_MEMBER_SIZE	16		// (B) What each member takes in an ArduinoJson v5 buffer on the ESP8266 (32-bit pointers)
+#define JSON_OBJECT_SIZE	8
+
+
+/**********************      Serialization      **********************/
+void printJsonString(const char* s, std::string& out) {
+	out += '"';
+	for (; *s; ++s) {
+		switch (*s) {
+			case '"':	out += "\\\""; break;
+			case '\\':	out += "\\\\"; break;
+			case '\n':	out += "\\n"; break;
+			case '\r':	out += "\\r"; break;
+			case '\t':	out += "\\t"; break;
+			default:	out += *s; break;
+		}
+	}
+	out += '"';
+}
+
+void JsonVariant::printTo(std::string& out) const {
+	char buf[32];
+	switch (type) {
+		case JSON_STRING:	printJsonString(value.s, out); break;
+		case JSON_INTEGER:	snprintf(buf, sizeof(buf), "%lld", value.i); out += buf; break;
+		case JSON_FLOAT:	snprintf(buf, sizeof(buf), "%.9g", value.f); out += buf; break;
+		case JSON_BOOLEAN:	out += value.b? "true" : "false"; break;
+		case JSON_OBJECT:	value.o->printTo(out); break;
+		default:			out += "null"; break;
+	}
+}
+
+void JsonObject::printTo(std::string& out) const {
+	out += '{';
+	for (size_t i=0; i<members.size(); ++i) {
+		if (i > 0) out += ',';
+		printJsonString(members[i].first, out);
+		out += ':';
+		members[i].second.printTo(out);
+	}
+	out += '}';
+}
+
+bool JsonObject::set(const char* key, const JsonVariant& value) {
+	if (!buffer) return false;
+	for (auto& m : members) {
+		if (strcmp(m.first, key) == 0) {
+			m.second = value;
+			return true;
+		}
+	}
+	if (!buffer->reserve(JSON_MEMBER_SIZE)) return false;
+	members.push_back(std::make_pair(key, value));
+	return true;
+}
+
+JsonObject& JsonObject::createNestedObject(const char* key) {
+	if (!buffer) return invalid();
+	JsonObject& obj = buffer->createObject();
+	if (!obj.success() || !set(key, JsonVariant(obj))) return invalid();
+	return obj;
+}
+
+
+/**********************      Parser      **********************/
+class JsonParser {	// Recursive descent parser (objects, strings, numbers, booleans and null; arrays are skipped)
+public:
+	JsonParser(JsonBuffer& buffer, const char* json) : buffer(buffer), p(json) {}
+
+	JsonObject* parseObject() {
+		skipSpace();
+		if (*p++ != '{') return NULL;
+		JsonObject& obj = buffer.createObject();
+		if (!obj.success()) return NULL;
+		skipSpace();
+		if (*p == '}') { ++p; return &obj; }
+		while (true) {
+			skipSpace();
+			std::string key;
+			if (*p != '"' || !parseString(key)) return NULL;
+			const char* k = buffer.copyString(key);
+			skipSpace();
+			if (!k || *p++ != ':') return NULL;
+			JsonVariant value;
+			if (!parseValue(value) || !obj.set(k, value)) return NULL;
+			skipSpace();
+			if (*p == ',') { ++p; continue; }
+			if (*p++ == '}') return &obj;
+			return NULL;
+		}
+	}
+
+protected:
+	JsonBuffer& buffer;
+	const char* p;
+
+	void skipSpace() { while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p; }
+
+	bool parseString(std::string& s) {
+		++p;	// (Opening quote)
+		for (; *p && *p != '"'; ++p) {
+			if (*p != '\\') { s += *p; continue; }
+			switch (*++p) {
+				case 'n':	s += '\n'; break;
+				case 'r':	s += '\r'; break;
+				case 't':	s += '\t'; break;
+				case 'b':	s += '\b'; break;
+				case 'f':	s += '\f'; break;
+				case 'u':	{ unsigned c = 0; for (uint8_t i=0; i<4 && isxdigit(p[1]); ++i) c = c*16 + (isdigit(*++p)? *p-'0' : (tolower(*p)-'a'+10)); s += (c < 0x80)? (char)c : '?'; break; }
+				case '\0':	return false;
+				default:	s += *p; break;
+			}
+		}
+		if (*p != '"') return false;
+		++p;
+		return true;
+	}
+
+	bool parseValue(JsonVariant& value) {
+		skipSpace();
+		if (*p == '{') {
+			JsonObject* obj = parseObject();
+			if (!obj) return false;
+			value = JsonVariant(*obj);
+		} else if (*p == '[') {	// (Skipped)
+			for (int depth=0; *p; ) {
+				if (*p == '"') { std::string ignored; if (!parseString(ignored)) return false; continue; }
+				if (*p == '[') ++depth;
+				if (*p++ == ']' && --depth == 0) return true;
+			}
+			return false;
+		} else if (*p == '"') {
+			std::string s;
+			if (!parseString(s)) return false;
+			const char* copy = buffer.copyString(s);
+			if (!copy) return false;
+			value = JsonVariant(copy);
+		} else if (strncmp(p, "true", 4) == 0) {
+			p += 4;
+			value = JsonVariant(true);
+		} else if (strncmp(p, "false", 5) == 0) {
+			p += 5;
+			value = JsonVariant(false);
+		} else if (strncmp(p, "null", 4) == 0) {
+			p += 4;
+			value = JsonVariant();
+		} else {
+			char* end;
+			const long long i = strtoll(p, &end, 10);
+			if (end == p) return false;
+			if (*end == '.' || *end == 'e' || *end == 'E') {
+				value = JsonVariant(strtod(p, &end));
+			} else {
+				value = JsonVariant(i);
+			}
+			p = end;
+		}
+		return true;
+	}
+};
+
+
+/**********************      JsonBuffer      **********************/
+JsonObject& JsonBuffer::createObject() {
+	if (!reserve(JSON_OBJECT_SIZE)) return JsonObject::invalid();
+	objects.push_back(JsonObject(this));
+	return objects.back();
+}
+
+const char* JsonBuffer::copyString(const std::string& s) {
+	if (!reserve(s.size() + 1)) return NULL;
+	strings.push_back(s);
+	return strings.back().c_str();
+}
+
+JsonObject& JsonBuffer::parseObject(char* json) {
+	if (!json) return JsonObject::invalid();
+	JsonObject* obj = JsonParser(*this, json).parseObject();
+	return obj? *obj : JsonObject::invalid();
+}
+
+JsonObject& JsonBuffer::parseObject(Stream& in) {
+	std::string json;
+	for (int c; (c = in.read()) >= 0; ) json += (char)c;
+	return parseObject(&json[0]);
+}
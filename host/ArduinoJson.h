@@ -0,0 +1,137 @@
+/******      Host shim: ArduinoJson (v5)      ******/
+#ifndef HOST_ARDUINO_JSON_H_
+#define HOST_ARDUINO_JSON_H_
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+#include <type_traits>
+
+class JsonObject;
+class JsonBuffer;
+
+
+/**********************      JsonVariant      **********************/
+class JsonVariant {	// Value of an object member (arrays aren't supported: they're parsed, but read back as undefined)
+public:
+	enum Type {JSON_UNDEFINED=0, JSON_STRING, JSON_INTEGER, JSON_FLOAT, JSON_BOOLEAN, JSON_OBJECT};
+
+	JsonVariant() : type(JSON_UNDEFINED) {}
+	JsonVariant(const char* s) : type(s? JSON_STRING : JSON_UNDEFINED) { value.s = s; }	// (Only the pointer is kept, like ArduinoJson does for const char*)
+	JsonVariant(bool b) : type(JSON_BOOLEAN) { value.b = b; }
+	JsonVariant(float f) : type(JSON_FLOAT) { value.f = f; }
+	JsonVariant(double f) : type(JSON_FLOAT) { value.f = f; }
+	JsonVariant(JsonObject& o) : type(JSON_OBJECT) { value.o = &o; }
+	template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> JsonVariant(T i) : type(JSON_INTEGER) { value.i = i; }
+
+	bool success() const { return type != JSON_UNDEFINED; }
+	template<typename T> typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, T>::type as() const {
+		switch (type) {
+			case JSON_INTEGER:	return (T)value.i;
+			case JSON_FLOAT:	return (T)value.f;
+			case JSON_BOOLEAN:	return (T)value.b;
+			case JSON_STRING:	return std::is_floating_point<T>::value? (T)strtod(value.s, NULL) : (T)strtoll(value.s, NULL, 10);
+			default:			return 0;
+		}
+	}
+	template<typename T> typename std::enable_if<std::is_same<T, bool>::value, T>::type as() const { return (type == JSON_BOOLEAN)? value.b : as<long long>() != 0; }
+	template<typename T> typename std::enable_if<std::is_same<T, const char*>::value, T>::type as() const { return (type == JSON_STRING)? value.s : NULL; }
+	template<typename T> typename std::enable_if<std::is_same<T, JsonObject&>::value, T>::type as() const;
+	template<typename T> operator T() const { return as<T>(); }
+
+	void printTo(std::string& out) const;
+
+protected:
+	Type type;
+	union {
+		const char* s;
+		long long i;
+		double f;
+		bool b;
+		JsonObject* o;
+	} value;
+};
+
+/**********************      JsonObject      **********************/
+class JsonObjectSubscript;
+
+class JsonObject {
+public:
+	JsonObject(JsonBuffer* buffer=NULL) : buffer(buffer) {}
+
+	static JsonObject& invalid() { static JsonObject obj; return obj; }
+	bool success() const { return buffer != NULL; }
+	size_t size() const { return members.size(); }
+	bool containsKey(const char* key) const { return find(key) != NULL; }
+	JsonVariant get(const char* key) const { const JsonVariant* v = find(key); return v? *v : JsonVariant(); }
+	bool set(const char* key, const JsonVariant& value);	// (key must outlive the object, like in ArduinoJson)
+	JsonObjectSubscript operator[](const char* key);
+	JsonVariant operator[](const char* key) const { return get(key); }
+	JsonObject& createNestedObject(const char* key);
+
+	size_t printTo(Print& out) const { std::string s; printTo(s); return out.write((const uint8_t*)s.data(), s.size()); }
+	size_t printTo(char* buf, size_t size) const { std::string s; printTo(s); return strlcpy(buf, s.c_str(), size); }
+	size_t measureLength() const { std::string s; printTo(s); return s.size(); }
+	void printTo(std::string& out) const;
+
+protected:
+	JsonBuffer* buffer;	// (NULL if invalid)
+	std::vector<std::pair<const char*, JsonVariant>> members;
+
+	const JsonVariant* find(const char* key) const {
+		for (const auto& m : members) {
+			if (strcmp(m.first, key) == 0) return &m.second;
+		}
+		return NULL;
+	}
+};
+
+class JsonObjectSubscript {	// obj[key]: reads like the member's JsonVariant, assigning to it sets the member
+public:
+	JsonObjectSubscript(JsonObject& obj, const char* key) : obj(obj), key(key) {}
+
+	template<typename T> JsonObjectSubscript& operator=(const T& value) { obj.set(key, JsonVariant(value)); return *this; }
+	bool success() const { return obj.containsKey(key); }
+	template<typename T> T as() const { return obj.get(key).template as<T>(); }
+	template<typename T> operator T() const { return as<T>(); }
+
+protected:
+	JsonObject& obj;
+	const char* key;
+};
+
+inline JsonObjectSubscript JsonObject::operator[](const char* key) { return JsonObjectSubscript(*this, key); }
+template<typename T> typename std::enable_if<std::is_same<T, JsonObject&>::value, T>::type JsonVariant::as() const { return (type == JSON_OBJECT)? *value.o : JsonObject::invalid(); }
+
+/**********************      JsonBuffer      **********************/
+class JsonBuffer {	// Owns every object and copied string of the documents parsed into / created in it
+public:
+	JsonBuffer(size_t capacity) : capacity(capacity), used(0) {}
+
+	JsonObject& createObject();
+	JsonObject& parseObject(char* json);	// (Parsed strings are copied, not referenced)
+	JsonObject& parseObject(const String& json) { std::string s(json.c_str()); return parseObject(&s[0]); }
+	JsonObject& parseObject(Stream& in);
+	size_t size() const { return used; }	// (Approximate: bytes ArduinoJson would have used on the ESP8266)
+
+	const char* copyString(const std::string& s);	// Returns NULL if the buffer is full
+	bool reserve(size_t bytes) { if (used + bytes > capacity) return false; used += bytes; return true; }
+
+protected:
+	const size_t capacity;
+	size_t used;
+	std::deque<JsonObject> objects;
+	std::deque<std::string> strings;
+};
+
+template<size_t CAPACITY> class StaticJsonBuffer : public JsonBuffer {
+public:
+	StaticJsonBuffer() : JsonBuffer(CAPACITY) {}
+};
+
+class DynamicJsonBuffer : public JsonBuffer {
+public:
+	DynamicJsonBuffer() : JsonBuffer((size_t)-1) {}
+};
+
+#endif
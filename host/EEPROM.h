@@ -0,0 +1,25 @@
+/******      Host shim: EEPROM      ******/
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <Arduino.h>
+#include <vector>
+
+
+/**********************      EEPROMClass      **********************/
+class EEPROMClass {	// In-memory, so every run starts from an erased EEPROM
+public:
+	void begin(size_t size) { data.resize(size, 0xFF); }
+	uint8_t read(int address) { return (address < (int)data.size())? data[address] : 0xFF; }
+	void write(int address, uint8_t value) { if (address < (int)data.size()) data[address] = value; }
+	template<typename T> T& get(int address, T& t) { if (address + sizeof(T) <= data.size()) memcpy(&t, &data[address], sizeof(T)); return t; }
+	template<typename T> const T& put(int address, const T& t) { if (address + sizeof(T) <= data.size()) memcpy(&data[address], &t, sizeof(T)); return t; }
+	bool commit() { return true; }
+	void end() {}
+
+protected:
+	std::vector<uint8_t> data;
+};
+extern EEPROMClass EEPROM;
+
+#endif
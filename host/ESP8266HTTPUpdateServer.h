@@ -0,0 +1,7 @@
+/******      Host shim: ESP8266HTTPUpdateServer (there's no firmware to update)      ******/
+#ifndef HOST_ESP8266_HTTP_UPDATE_SERVER_H_
+#define HOST_ESP8266_HTTP_UPDATE_SERVER_H_
+
+#include <Arduino.h>
+
+#endif
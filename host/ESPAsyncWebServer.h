@@ -0,0 +1,29 @@
+/******      Host shim: ESPAsyncWebServer      ******/
+#ifndef HOST_ESP_ASYNC_WEB_SERVER_H_
+#define HOST_ESP_ASYNC_WEB_SERVER_H_
+
+#include <Arduino.h>
+
+
+/**********************      Requests and responses      **********************/
+class AsyncWebServerResponse {	// (Only what the sketch's handlers build, there's no server to send it through)
+public:
+	AsyncWebServerResponse(int code, const String& contentType, const String& content) : code(code), contentType(contentType), content(content) {}
+	void addHeader(const String& name, const String& value) {}
+
+	int code;
+	String contentType, content;
+};
+
+class AsyncWebServerRequest {	// Collects whatever the handler sends, so tests can inspect it
+public:
+	~AsyncWebServerRequest() { delete response; }
+
+	AsyncWebServerResponse* beginResponse(int code, const String& contentType, const String& content=String()) { return new AsyncWebServerResponse(code, contentType, content); }
+	void send(AsyncWebServerResponse* r) { delete response; response = r; }
+	void send(int code, const String& contentType=String(), const String& content=String()) { send(beginResponse(code, contentType, content)); }
+
+	AsyncWebServerResponse* response = NULL;
+};
+
+#endif
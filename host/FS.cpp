@@ -0,0 +1,82 @@
+/******      Host shim: SPIFFS      ******/
+#include "FS.h"
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+
+FS SPIFFS;
+
+
+/**********************      File      **********************/
+size_t File::size() const {
+	struct stat st;
+	if (f) fflush(f.get());	// (Writes still in the stdio buffer count too)
+	return (f && fstat(fileno(f.get()), &st) == 0)? st.st_size : 0;
+}
+
+File Dir::openFile(const char* mode) {
+	return SPIFFS.open(fileName(), mode);
+}
+
+
+/**********************      FS      **********************/
+String hostPath(const String& path) {	// Host path of a SPIFFS path
+	return String(hostSpiffsRoot()) + (path.startsWith("/")? "" : "/") + path;
+}
+
+bool makeParentDirs(const String& hostFile) {	// SPIFFS paths can contain '/' without any directory being created first
+	std::string dir(hostFile.c_str());
+	for (size_t i=strlen(hostSpiffsRoot())+1; (i = dir.find('/', i)) != std::string::npos; ++i) {
+		if (mkdir(dir.substr(0, i).c_str(), 0755) != 0 && errno != EEXIST) return false;
+	}
+	return true;
+}
+
+void listFiles(const std::string& hostDir, const std::string& spiffsDir, std::vector<String>& files) {
+	DIR* d = opendir(hostDir.c_str());
+	if (!d) return;
+	while (struct dirent* e = readdir(d)) {
+		if (e->d_name[0] == '.') continue;
+		const std::string host = hostDir + "/" + e->d_name, spiffs = spiffsDir + "/" + e->d_name;
+		struct stat st;
+		if (stat(host.c_str(), &st) != 0) continue;
+		if (S_ISDIR(st.st_mode)) listFiles(host, spiffs, files);
+		else files.push_back(String(spiffs));
+	}
+	closedir(d);
+}
+
+bool FS::begin() {
+	return hostSpiffsRoot()[0] != '\0';
+}
+
+File FS::open(const String& path, const char* mode) {
+	const String file = hostPath(path);
+	if (mode[0] != 'r' && !makeParentDirs(file)) return File();
+	struct stat st;
+	if (stat(file.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) return File();
+	FILE* f = fopen(file.c_str(), (mode[0] == 'r')? "rb" : (mode[0] == 'a')? "ab+" : "wb+");
+	return f? File(f, path) : File();
+}
+
+bool FS::exists(const String& path) {
+	struct stat st;
+	return stat(hostPath(path).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool FS::remove(const String& path) {
+	return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const String& from, const String& to) {
+	if (exists(to)) return false;	// (SPIFFS can't rename over an existing file)
+	return makeParentDirs(hostPath(to)) && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+Dir FS::openDir(const String& path) {
+	std::vector<String> files;
+	std::string dir(path.c_str());
+	while (!dir.empty() && dir.back() == '/') dir.pop_back();
+	listFiles(hostPath(String(dir)).c_str(), dir, files);
+	return Dir(files);
+}
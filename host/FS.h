@@ -0,0 +1,67 @@
+/******      Host shim: SPIFFS      ******/
+#ifndef HOST_FS_H_
+#define HOST_FS_H_
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+
+/**********************      File      **********************/
+class File : public Stream {	// SPIFFS file, backed by a host file under hostSpiffsRoot()
+public:
+	File() {}
+	File(FILE* f, const String& path) : f(f, fclose), path(path) {}
+
+	operator bool() const { return (bool)f; }
+	void close() { f.reset(); }
+	size_t size() const;
+	size_t position() const { return f? ftell(f.get()) : 0; }
+	bool seek(uint32_t pos) { return f && fseek(f.get(), pos, SEEK_SET) == 0; }
+	const char* name() const { return path.c_str(); }
+
+	using Print::write;
+	using Stream::readBytes;
+	size_t write(uint8_t c) { return f? fwrite(&c, 1, 1, f.get()) : 0; }
+	size_t write(const uint8_t* buf, size_t len) { return f? fwrite(buf, 1, len, f.get()) : 0; }
+	int available() { return f? size() - position() : 0; }
+	int read() { return f? fgetc(f.get()) : -1; }
+	int peek() { if (!f) return -1; int c = fgetc(f.get()); if (c >= 0) ungetc(c, f.get()); return c; }
+	size_t read(uint8_t* buf, size_t len) { return f? fread(buf, 1, len, f.get()) : 0; }
+	size_t readBytes(char* buf, size_t len) { return read((uint8_t*)buf, len); }
+	void flush() { if (f) fflush(f.get()); }
+
+protected:
+	std::shared_ptr<FILE> f;	// (Copies share the file, like SPIFFS Files do)
+	String path;
+};
+
+/**********************      Dir      **********************/
+class Dir {	// Every file whose path starts with the directory's (SPIFFS has no real directories)
+public:
+	Dir(std::vector<String> files=std::vector<String>()) : files(files), idx(-1) {}
+
+	bool next() { return ++idx < (int)files.size(); }
+	String fileName() const { return (idx >= 0 && idx < (int)files.size())? files[idx] : String(); }
+	File openFile(const char* mode);
+
+protected:
+	std::vector<String> files;
+	int idx;
+};
+
+/**********************      FS      **********************/
+class FS {
+public:
+	bool begin();
+	void end() {}
+	bool format() { hostSpiffsFormat(); return true; }
+	File open(const String& path, const char* mode);
+	bool exists(const String& path);
+	bool remove(const String& path);
+	bool rename(const String& from, const String& to);
+	Dir openDir(const String& path);
+};
+extern FS SPIFFS;
+
+#endif
@@ -0,0 +1,22 @@
+/******      Host shim: IPAddress      ******/
+#ifndef HOST_IP_ADDRESS_H_
+#define HOST_IP_ADDRESS_H_
+
+#include <Arduino.h>
+
+
+/**********************      IPAddress      **********************/
+class IPAddress {
+public:
+	IPAddress() : addr{0, 0, 0, 0} {}
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr{a, b, c, d} {}
+
+	uint8_t operator[](int i) const { return addr[i]; }
+	uint8_t& operator[](int i) { return addr[i]; }
+	String toString() const { char buf[16]; snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]); return String(buf); }
+
+protected:
+	uint8_t addr[4];
+};
+
+#endif
@@ -0,0 +1,137 @@
+/******      Host shim: NeoPixelBus      ******/
+#ifndef HOST_NEO_PIXEL_BUS_H_
+#define HOST_NEO_PIXEL_BUS_H_
+
+#include <Arduino.h>
+#include <vector>
+
+#define HOST_NEO_US_PER_PIXEL	30		// (us) 24 bits at 800Kbps
+#define HOST_NEO_RESET_US		50		// (us) Latch time after the last bit
+#define HOST_NEO_UART_FIFO_US	320		// (us) How much of the frame the UART FIFO still holds when the blocking UART method returns (128 B, 4 UART bytes per pixel byte)
+
+
+/**********************      Colors      **********************/
+struct HsbColor {
+	HsbColor(float h, float s, float b) : H(h), S(s), B(b) {}
+	float H, S, B;
+};
+
+struct RgbColor {
+	RgbColor() : R(0), G(0), B(0) {}
+	RgbColor(uint8_t r, uint8_t g, uint8_t b) : R(r), G(g), B(b) {}
+	RgbColor(uint8_t brightness) : R(brightness), G(brightness), B(brightness) {}
+	RgbColor(const HsbColor& c) {	// (Same conversion as NeoPixelBus)
+		float r = c.B, g = c.B, b = c.B;
+		if (c.S != 0) {
+			const float h = (c.H == 1.0f)? 0 : c.H*6, f = h - floorf(h);
+			const float p = c.B*(1 - c.S), q = c.B*(1 - c.S*f), t = c.B*(1 - c.S*(1 - f));
+			switch ((int)h) {
+				case 0:  r = c.B; g = t; b = p; break;
+				case 1:  r = q; g = c.B; b = p; break;
+				case 2:  r = p; g = c.B; b = t; break;
+				case 3:  r = p; g = q; b = c.B; break;
+				case 4:  r = t; g = p; b = c.B; break;
+				default: r = c.B; g = p; b = q; break;
+			}
+		}
+		R = r*255; G = g*255; B = b*255;
+	}
+	bool operator==(const RgbColor& o) const { return R == o.R && G == o.G && B == o.B; }
+	bool operator!=(const RgbColor& o) const { return !(*this == o); }
+
+	uint8_t R, G, B;
+};
+
+/**********************      Features      **********************/
+class NeoGrbFeature {
+public:
+	static const size_t PixelSize = 3;
+	static void applyPixelColor(uint8_t* pixels, uint16_t i, RgbColor c) { uint8_t* p = pixels + i*PixelSize; p[0] = c.G; p[1] = c.R; p[2] = c.B; }
+	static RgbColor retrievePixelColor(const uint8_t* pixels, uint16_t i) { const uint8_t* p = pixels + i*PixelSize; return RgbColor(p[1], p[0], p[2]); }
+};
+
+/**********************      Methods      **********************/
+class HostNeoMethod {	// Timing model of the ESP8266 methods on the host's clock (see hostSupport.h): how long each Show blocks, whether interrupts stay enabled meanwhile and when the next frame can start
+public:
+	HostNeoMethod(uint16_t pixelCount, size_t elementSize) : pixels(pixelCount*elementSize), tFrameUs(pixelCount*HOST_NEO_US_PER_PIXEL), tReady(0) {}
+
+	bool IsReadyToUpdate() const { return (int32_t)(micros() - tReady) >= 0; }
+	void Initialize() { tReady = micros(); }
+	uint8_t* getPixels() { return pixels.data(); }
+	size_t getPixelsSize() const { return pixels.size(); }
+	static inline uint32_t updateCount = 0;	// Number of frames sent
+	static inline uint32_t blockedUs = 0;		// (us) Time Update spent blocking the caller
+
+protected:
+	std::vector<uint8_t> pixels;
+	const uint32_t tFrameUs;
+	uint32_t tReady;	// (us) When the previous frame (and its latch) is done
+
+	void block(uint32_t us, bool interruptsEnabled) { hostAdvanceMicros(us, interruptsEnabled); blockedUs += us; }
+	void waitReady() { if (!IsReadyToUpdate()) block(tReady - micros(), true); }	// (The real methods spin in Update until the previous frame is out)
+};
+
+class NeoEsp8266Dma800KbpsMethod : public HostNeoMethod {	// I2S DMA: the frame goes out in the background
+public:
+	NeoEsp8266Dma800KbpsMethod(uint8_t pin, uint16_t pixelCount, size_t elementSize) : HostNeoMethod(pixelCount, elementSize) {}
+	void Update(bool maintainBufferConsistency=true) { waitReady(); tReady = micros() + tFrameUs + HOST_NEO_RESET_US; ++updateCount; }
+};
+
+class NeoEsp8266AsyncUart800KbpsMethod : public HostNeoMethod {	// UART1 fed from its interrupt: the frame goes out in the background
+public:
+	NeoEsp8266AsyncUart800KbpsMethod(uint8_t pin, uint16_t pixelCount, size_t elementSize) : HostNeoMethod(pixelCount, elementSize) {}
+	void Update(bool maintainBufferConsistency=true) { waitReady(); tReady = micros() + tFrameUs + HOST_NEO_RESET_US; ++updateCount; }
+};
+
+class NeoEsp8266Uart800KbpsMethod : public HostNeoMethod {	// UART1: Update blocks (with interrupts enabled) until the rest of the frame fits in the FIFO
+public:
+	NeoEsp8266Uart800KbpsMethod(uint8_t pin, uint16_t pixelCount, size_t elementSize) : HostNeoMethod(pixelCount, elementSize) {}
+	void Update(bool maintainBufferConsistency=true) {
+		waitReady();
+		const uint32_t tFifo = min(tFrameUs, (uint32_t)HOST_NEO_UART_FIFO_US);
+		block(tFrameUs - tFifo, true);
+		tReady = micros() + tFifo + HOST_NEO_RESET_US;
+		++updateCount;
+	}
+};
+
+class NeoEsp8266BitBang800KbpsMethod : public HostNeoMethod {	// Bit-banged: Update blocks with interrupts disabled for the whole frame
+public:
+	NeoEsp8266BitBang800KbpsMethod(uint8_t pin, uint16_t pixelCount, size_t elementSize) : HostNeoMethod(pixelCount, elementSize) {}
+	void Update(bool maintainBufferConsistency=true) {
+		waitReady();
+		block(tFrameUs, false);
+		tReady = micros() + HOST_NEO_RESET_US;
+		++updateCount;
+	}
+};
+
+/**********************      NeoPixelBus      **********************/
+template<typename T_COLOR_FEATURE, typename T_METHOD> class NeoPixelBus {
+public:
+	NeoPixelBus(uint16_t countPixels, uint8_t pin) : countPixels(countPixels), method(pin, countPixels, T_COLOR_FEATURE::PixelSize), dirty(false) {}
+
+	void Begin() { method.Initialize(); Dirty(); }
+	void Show(bool maintainBufferConsistency=true) {
+		if (!dirty) return;
+		method.Update(maintainBufferConsistency);
+		ResetDirty();
+	}
+	bool CanShow() const { return method.IsReadyToUpdate(); }
+	bool IsDirty() const { return dirty; }
+	void Dirty() { dirty = true; }
+	void ResetDirty() { dirty = false; }
+	uint8_t* Pixels() { return method.getPixels(); }
+	size_t PixelsSize() const { return method.getPixelsSize(); }
+	uint16_t PixelCount() const { return countPixels; }
+	void SetPixelColor(uint16_t i, RgbColor c) { if (i < countPixels) { T_COLOR_FEATURE::applyPixelColor(Pixels(), i, c); Dirty(); } }
+	RgbColor GetPixelColor(uint16_t i) { return (i < countPixels)? T_COLOR_FEATURE::retrievePixelColor(Pixels(), i) : RgbColor(0); }
+	void ClearTo(RgbColor c) { for (uint16_t i=0; i<countPixels; ++i) SetPixelColor(i, c); }
+
+protected:
+	const uint16_t countPixels;
+	T_METHOD method;
+	bool dirty;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/******      Host shim: SPI      ******/
+#ifndef HOST_SPI_H_
+#define HOST_SPI_H_
+
+#include <Arduino.h>
+
+#define SPI_MODE0		0x00
+#define SPI_CLOCK_DIV8	0x00
+#define SPIBUSY			0		// (Transfers complete instantly, so sample_isr never spins)
+#define SPIMMOSI		0x1FF
+#define SPILMOSI		17
+#define SPIMMISO		0x1FF
+#define SPILMISO		8
+
+extern volatile uint32_t SPI1CMD, SPI1W0, SPI1U1;	// (Plain variables standing in for the HSPI registers: reading SPI1W0 yields whatever was last written, ie 0)
+
+
+/**********************      SPIClass      **********************/
+class SPIClass {
+public:
+	void begin() {}
+	void setDataMode(uint8_t mode) {}
+	void setBitOrder(uint8_t order) {}
+	void setClockDivider(uint32_t div) {}
+	void setHwCs(bool use) {}
+};
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,7 @@
+/******      Host shim: SPIFFSEditor (nothing to serve it through)      ******/
+#ifndef HOST_SPIFFS_EDITOR_H_
+#define HOST_SPIFFS_EDITOR_H_
+
+#include <ESPAsyncWebServer.h>
+
+#endif
@@ -0,0 +1,28 @@
+/******      Host shim: WebSocketsServer      ******/
+#ifndef HOST_WEB_SOCKETS_SERVER_H_
+#define HOST_WEB_SOCKETS_SERVER_H_
+
+#include <Arduino.h>
+
+typedef enum {WStype_ERROR, WStype_DISCONNECTED, WStype_CONNECTED, WStype_TEXT, WStype_BIN} WStype_t;
+
+
+/**********************      WebSocketsServer      **********************/
+class WebSocketsServer {	// No clients ever connect on the host: every send is dropped
+public:
+	typedef void (*WebSocketServerEvent)(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
+
+	WebSocketsServer(uint16_t port) {}
+	void begin() {}
+	void loop() {}
+	void onEvent(WebSocketServerEvent cbEvent) {}
+	void setAuthorization(const char* user, const char* pass) {}
+	uint8_t connectedClients() { return 0; }
+	bool sendTXT(uint8_t num, const char* payload, size_t length=0) { return false; }
+	bool sendTXT(uint8_t num, const String& payload) { return false; }
+	bool broadcastTXT(const char* payload, size_t length=0) { return false; }
+	bool broadcastTXT(const String& payload) { return false; }
+	bool broadcastBIN(const uint8_t* payload, size_t length) { return false; }
+};
+
+#endif
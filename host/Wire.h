@@ -0,0 +1,20 @@
+/******      Host shim: Wire (I2C)      ******/
+#ifndef HOST_WIRE_H_
+#define HOST_WIRE_H_
+
+#include <Arduino.h>
+
+
+/**********************      TwoWire      **********************/
+class TwoWire {	// No I2C devices on the host: writes are dropped, reads return 0
+public:
+	void begin() {}
+	void beginTransmission(uint8_t address) {}
+	size_t write(uint8_t data) { return 1; }
+	uint8_t endTransmission() { return 0; }
+	uint8_t requestFrom(uint8_t address, uint8_t quantity) { return quantity; }
+	int read() { return 0; }
+};
+extern TwoWire Wire;
+
+#endif
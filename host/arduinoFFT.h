@@ -0,0 +1,81 @@
+/******      Host shim: arduinoFFT      ******/
+#ifndef HOST_ARDUINO_FFT_H_
+#define HOST_ARDUINO_FFT_H_
+
+#include <stdint.h>
+#include <math.h>
+
+#define FFT_FORWARD			0x01
+#define FFT_REVERSE			0x00
+#define FFT_WIN_TYP_RECTANGLE	0x00
+#define FFT_WIN_TYP_HAMMING		0x01
+#define FFT_WIN_TYP_HANN		0x02
+
+
+/**********************      arduinoFFT      **********************/
+class arduinoFFT {	// Same API, windows and results (up to rounding) as arduinoFFT 1.x: in-place radix-2 FFT on double buffers
+public:
+	arduinoFFT(double* vReal, double* vImag, uint16_t samples, double samplingFrequency) : vReal(vReal), vImag(vImag), samples(samples), samplingFrequency(samplingFrequency) {}
+
+	void Windowing(double* vData, uint16_t n, uint8_t windowType, uint8_t dir) {	// Symmetric window (like arduinoFFT: over n-1, applied from both ends)
+		for (uint16_t i=0; i<n/2; ++i) {
+			const double ratio = i/(n - 1.0);
+			double w = 1;
+			if (windowType == FFT_WIN_TYP_HAMMING) w = 0.54 - 0.46*cos(2*M_PI*ratio);
+			else if (windowType == FFT_WIN_TYP_HANN) w = 0.5*(1 - cos(2*M_PI*ratio));
+			if (dir == FFT_FORWARD) {
+				vData[i] *= w;
+				vData[n - 1 - i] *= w;
+			} else {
+				vData[i] /= w;
+				vData[n - 1 - i] /= w;
+			}
+		}
+	}
+
+	void Compute(uint8_t dir) {
+		for (uint16_t i=1, j=0; i<samples; ++i) {	// Bit-reversal permutation
+			uint16_t bit = samples >> 1;
+			for (; j & bit; bit >>= 1) j ^= bit;
+			j ^= bit;
+			if (i < j) {
+				swap(vReal[i], vReal[j]);
+				swap(vImag[i], vImag[j]);
+			}
+		}
+		for (uint16_t len=2; len<=samples; len <<= 1) {
+			const double angle = ((dir == FFT_FORWARD)? -2 : 2)*M_PI/len;
+			for (uint16_t i=0; i<samples; i+=len) {
+				for (uint16_t k=0; k<len/2; ++k) {
+					const double wr = cos(angle*k), wi = sin(angle*k);
+					double* ar = &vReal[i+k], *ai = &vImag[i+k], *br = &vReal[i+k+len/2], *bi = &vImag[i+k+len/2];
+					const double tr = *br*wr - *bi*wi, ti = *br*wi + *bi*wr;
+					*br = *ar - tr; *bi = *ai - ti;
+					*ar += tr; *ai += ti;
+				}
+			}
+		}
+		if (dir == FFT_REVERSE) {
+			for (uint16_t i=0; i<samples; ++i) {
+				vReal[i] /= samples;
+				vImag[i] /= samples;
+			}
+		}
+	}
+
+	void ComplexToMagnitude() {	// |vReal + j*vImag| -> vReal
+		for (uint16_t i=0; i<samples; ++i) {
+			vReal[i] = sqrt(vReal[i]*vReal[i] + vImag[i]*vImag[i]);
+		}
+	}
+
+protected:
+	double* vReal;
+	double* vImag;
+	uint16_t samples;
+	double samplingFrequency;
+
+	static void swap(double& a, double& b) { const double t = a; a = b; b = t; }
+};
+
+#endif
@@ -0,0 +1,140 @@
+/******      Host support      ******/
+#include "hostSupport.h"
+#include "webServer.h"					// consolePrintf and ConsolePrint (webServer.cpp itself isn't built for the host)
+#include <chrono>
+#include <thread>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ftw.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+SPIClass SPI;
+volatile uint32_t SPI1CMD, SPI1W0, SPI1U1;
+EEPROMClass EEPROM;
+uint32_t curr_time;	// (Defined by the sketch, which isn't built for the host)
+
+bool hostVirtual = false;
+uint64_t hostVirtualNs = 0;		// (ns) Virtual clock
+const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+HostIsrFunc hostTimerIsr = NULL;
+uint16_t hostTimerDivider = 0;
+uint64_t hostTimerPeriodNs = 0, hostTimerNextNs = 0;	// (ns) 0 = not running
+uint32_t hostTimerExpired = 0, hostTimerRan = 0;
+
+
+/***********************************************/
+/******      Host clock and interrupts      ******/
+/***********************************************/
+uint64_t hostNow() {	// (ns)
+	if (hostVirtual) return hostVirtualNs;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - hostStart).count();
+}
+
+void hostUseVirtualClock(bool on) {	// Switches to (and resets) the virtual clock, or back to the host's clock
+	hostVirtual = on;
+	hostVirtualNs = 0;
+	hostTimerNextNs = hostTimerPeriodNs;
+	hostTimerExpired = hostTimerRan = 0;
+}
+
+bool hostVirtualClock() { return hostVirtual; }
+uint32_t hostMillis() { return hostNow()/1000000; }
+uint32_t hostMicros() { return hostNow()/1000; }
+uint32_t hostNanos() { return hostNow(); }
+
+void hostAdvanceMicros(uint32_t us, bool interruptsEnabled) {	// (Virtual clock only) Moves time forward, firing timer1 on the way
+	if (!hostVirtual) return;
+	const uint64_t tEnd = hostVirtualNs + (uint64_t)us*1000;
+	bool pending = false;
+	while (hostTimerPeriodNs > 0 && hostTimerNextNs <= tEnd) {
+		hostVirtualNs = hostTimerNextNs;	// (So the ISR sees the time it fired at)
+		hostTimerNextNs += hostTimerPeriodNs;
+		++hostTimerExpired;
+		if (!interruptsEnabled) {	// The interrupt flag is already set: this expiration is lost
+			pending = true;
+		} else if (hostTimerIsr) {
+			++hostTimerRan;
+			hostTimerIsr();
+		}
+	}
+	hostVirtualNs = tEnd;
+	if (pending && hostTimerIsr) {	// Interrupts are back on
+		++hostTimerRan;
+		hostTimerIsr();
+	}
+}
+
+void hostSleepMicros(uint32_t us) {	// What delay/yield do: advances the virtual clock, or sleeps on the host's clock
+	if (hostVirtual) {
+		hostAdvanceMicros(us);
+	} else if (us > 0) {
+		std::this_thread::sleep_for(std::chrono::microseconds(us));
+	}
+}
+
+void hostTimerUpdate(uint32_t ticks) {
+	static uint32_t lastTicks = 0;
+	if (ticks) lastTicks = ticks;
+	hostTimerPeriodNs = (hostTimerDivider && lastTicks)? (uint64_t)lastTicks*hostTimerDivider*1000/HOST_APB_MHZ : 0;
+	hostTimerNextNs = hostNow() + hostTimerPeriodNs;
+}
+
+void hostTimerAttach(HostIsrFunc isr) { hostTimerIsr = isr; }
+void hostTimerEnable(uint16_t divider) { hostTimerDivider = divider; hostTimerUpdate(0); }
+void hostTimerWrite(uint32_t ticks) { hostTimerUpdate(ticks); }
+uint32_t hostTimerExpirations() { return hostTimerExpired; }
+uint32_t hostTimerServiced() { return hostTimerRan; }
+
+
+/***********************************************/
+/******      Host file system (SPIFFS)      ******/
+/***********************************************/
+const char* hostSpiffsRoot() {	// Host directory SPIFFS lives in ($HOST_SPIFFS_DIR, or a fresh temp directory)
+	static std::string root;
+	if (root.empty()) {
+		const char* dir = getenv("HOST_SPIFFS_DIR");
+		if (dir) {
+			root = dir;
+		} else {
+			char tmpl[] = "/tmp/spiffsXXXXXX";
+			root = mkdtemp(tmpl)? tmpl : "/tmp";
+			atexit([]() { hostSpiffsFormat(); rmdir(hostSpiffsRoot()); });
+		}
+	}
+	return root.c_str();
+}
+
+void hostSpiffsFormat() {	// Deletes every file in it
+	nftw(hostSpiffsRoot(), [](const char* path, const struct stat*, int type, struct FTW* ftw) { return (ftw->level > 0)? remove(path) : 0; }, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+
+/***************************************************/
+/******      Stand-ins for webServer.cpp      ******/
+/***************************************************/
+void addNoCacheHeaders(AsyncWebServerResponse* response) {}
+
+void consolePrintf(const char * format, ...) {	// Log messages through Serial (stdout)
+	char buf[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	Serial.print(buf);
+}
+
+size_t ConsolePrint::write(uint8_t c) {
+	line[len++] = c;
+	if (c == '\n' || len >= sizeof(line)-1) sendLine();	// Leave room for the '\0'
+	return 1;
+}
+
+void ConsolePrint::sendLine() {	// Sends whatever is buffered (even if there's no '\n' yet)
+	if (len == 0) return;
+	line[len] = '\0';
+	consolePrintf("%s", line);	// Don't use line as the format string, it could contain '%'
+	len = 0;
+}
@@ -0,0 +1,41 @@
+/******      Host support      ******/
+#ifndef HOST_SUPPORT_H_
+#define HOST_SUPPORT_H_
+
+#include <stdint.h>
+
+#define HOST_APB_MHZ	80		// timer1 counts at the APB clock (before its divider), regardless of the CPU clock
+
+typedef void (*HostIsrFunc)();
+
+
+/***********************************************/
+/******      Host clock and interrupts      ******/
+/***********************************************/
+/* By default millis/micros follow the host's monotonic clock and timer1 never fires (tests that need samples push them themselves).
+ * With the virtual clock, time only moves through hostAdvanceMicros (or delay/yield, which call it), and timer1 fires the ISR attached
+ * by timer1_attachInterrupt at the period programmed through timer1_enable/timer1_write, as many times as it'd have fired meanwhile.
+ * Code that runs with interrupts disabled (eg: a bit-banged strip) advances the clock with interruptsEnabled=false: like the real
+ * timer, only one expiration stays pending and fires once interrupts are back on, every other one is lost */
+void hostUseVirtualClock(bool on);	// Switches to (and resets) the virtual clock, or back to the host's clock
+bool hostVirtualClock();			// Whether the virtual clock is in use
+uint32_t hostMillis();				// (ms) What millis() returns
+uint32_t hostMicros();				// (us) What micros() returns
+uint32_t hostNanos();				// (ns, wraps around every ~4.3s) What ESP.getCycleCount() returns
+void hostAdvanceMicros(uint32_t us, bool interruptsEnabled=true);	// (Virtual clock only) Moves time forward, firing timer1 on the way
+void hostSleepMicros(uint32_t us);	// What delay/yield do: advances the virtual clock, or sleeps on the host's clock
+
+void hostTimerAttach(HostIsrFunc isr);
+void hostTimerEnable(uint16_t divider);	// (0 = disabled)
+void hostTimerWrite(uint32_t ticks);
+uint32_t hostTimerExpirations();	// Number of times timer1 expired since the virtual clock was reset...
+uint32_t hostTimerServiced();		// ...and how many of them actually ran the ISR (the rest were lost with interrupts disabled)
+
+
+/***********************************************/
+/******      Host file system (SPIFFS)      ******/
+/***********************************************/
+const char* hostSpiffsRoot();		// Host directory SPIFFS lives in ($HOST_SPIFFS_DIR, or a fresh temp directory)
+void hostSpiffsFormat();			// Deletes every file in it
+
+#endif
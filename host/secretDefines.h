@@ -0,0 +1,13 @@
+/******      Host stand-in for secretDefines.h (dummy credentials, nothing here is ever used to connect)      ******/
+#ifndef SECRET_DEFINES_H_
+#define SECRET_DEFINES_H_
+
+#define CONNECT_TO_SSID		"host"
+#define CONNECT_TO_PASS		"host"
+#define SOFT_AP_SSID		"host"
+#define SOFT_AP_PASS		"host"
+#define ARDUINO_OTA_USER	"host"
+#define ARDUINO_OTA_PASS	"host"
+#define SECRET_SERVER_PORT	8080
+
+#endif
@@ -0,0 +1,30 @@
+/******      LED frame buffer      ******/
+#include "ledFrame.h"
+
+
+/**********************      LedFrame      **********************/
+void LedFrame::setView(uint16_t offset, uint16_t length, uint8_t flags) {	// (Views only) Changes the range of the parent the view covers
+	if (!parent) return;
+	this->offset = min(offset, parent->PixelCount());
+	this->length = min(length, (uint16_t)(parent->PixelCount() - this->offset));
+	this->flags = flags;
+	count = (flags & LED_FRAME_MIRROR)? (this->length+1)/2 : this->length;
+}
+
+void LedFrame::ClearTo(RgbColor c) {	// Sets every pixel to c
+	for (uint16_t i=0; i<count; ++i) {
+		SetPixelColor(i, c);
+	}
+}
+
+void LedFrame::ShiftRight(uint16_t n) {	// Moves every pixel n positions up (the last n fall off the end, the first n keep their color)
+	if (n == 0 || n >= count) return;
+	if (parent) {	// Pixels of a view aren't contiguous (reversed, mirrored...), move them one by one
+		for (uint16_t i=count-1; i>=n; --i) {
+			SetPixelColor(i, GetPixelColor(i-n));
+		}
+		return;
+	}
+	memmove(pixels + n*LedStripFeature::PixelSize, pixels, (count-n)*LedStripFeature::PixelSize);
+	markDirty(n, count);
+}
@@ -0,0 +1,78 @@
+/******      LED frame buffer      ******/
+#ifndef LED_FRAME_H_
+#define LED_FRAME_H_
+
+#include <NeoPixelBus.h>				// RgbColor and the pixel features (byte order)
+
+#define LED_FRAME_REVERSE	0x01		// (View flag) Pixel 0 of the view is the last pixel of its range
+#define LED_FRAME_MIRROR	0x02		// (View flag) The view is half as long as its range and every pixel is drawn twice, symmetrically (from the ends towards the center, or from the center out if also LED_FRAME_REVERSE)
+
+typedef NeoGrbFeature LedStripFeature;	// Byte order of the pixels in the strip (and in every LedFrame, so frames can be copied straight into the strip)
+
+enum LedBlendMode {LED_BLEND_ADD=0, LED_BLEND_MAX, LED_BLEND_ALPHA, LED_BLEND_MULTIPLY, N_LED_BLEND_MODES};	// How a layer is combined with what's below it (see ledBlend)
+
+inline uint8_t ledBlend(uint8_t below, uint8_t above, LedBlendMode mode, uint8_t alpha) {	// Blends one channel of a pixel (integer only). alpha (0-255) scales how much of the layer above shows
+	const uint16_t w = alpha + (alpha >> 7);	// 0..256, so alpha=255 means exactly "all of above" with just shifts
+	switch (mode) {
+		case LED_BLEND_ADD:			{ uint16_t sum = below + ((above*w) >> 8); return (sum > 255)? 255 : sum; }
+		case LED_BLEND_MAX:			{ uint8_t a = (above*w) >> 8; return (a > below)? a : below; }
+		case LED_BLEND_ALPHA:		return below + (((int32_t)above - below)*w >> 8);	// Linear interpolation from below (alpha=0) to above (alpha=255)
+		case LED_BLEND_MULTIPLY:	{ uint8_t m = 255 - (((255 - above)*w) >> 8); return (below*(m+1)) >> 8; }	// Multiply by the layer (faded towards white by 1-alpha)
+		default:					return below;
+	}
+}
+
+
+/**********************      LedFrame      **********************/
+class LedFrame {	// Pixel buffer effects draw on (same API as NeoPixelBus). Keeps track of the range of pixels that changed since the last ResetDirty, so the presenter knows whether the strip needs a Show. A LedFrame can also be a view of a range of another frame (a segment), optionally reversed and/or mirrored
+public:
+	LedFrame(uint8_t* pixels, uint16_t count) : pixels(pixels), parent(NULL), offset(0), length(count), count(count), flags(0) { ResetDirty(); }	// Frame that owns (or wraps) a pixel buffer
+	LedFrame(LedFrame* parent, uint16_t offset, uint16_t length, uint8_t flags=0) : pixels(NULL), parent(parent) { setView(offset, length, flags); ResetDirty(); }	// View of pixels [offset, offset+length) of parent
+
+	void setView(uint16_t offset, uint16_t length, uint8_t flags=0);	// (Views only) Changes the range of the parent the view covers
+	void setCount(uint16_t count) { if (parent) return; this->count = length = count; ResetDirty(); }	// (Frames that wrap a buffer only) Changes how many pixels of the buffer the frame covers (the buffer must be at least that long) and clears the dirty range
+	uint16_t getOffset() const { return offset; }
+	uint16_t getLength() const { return length; }	// Number of pixels of the parent the view covers (PixelCount is half of it if mirrored)
+	uint8_t getFlags() const { return flags; }
+
+	uint16_t PixelCount() const { return count; }
+	uint8_t* Pixels() const { return pixels; }	// (NULL for views)
+
+	void SetPixelColor(uint16_t i, RgbColor c) {	// Out of range pixels are ignored. Only marks the pixel dirty if its color actually changed
+		if (i >= count) return;
+		if (parent) {
+			uint16_t p = (flags & LED_FRAME_REVERSE)? count-1-i : i;
+			parent->SetPixelColor(offset + p, c);
+			if (flags & LED_FRAME_MIRROR) parent->SetPixelColor(offset + length-1-p, c);
+			return;
+		}
+		if (GetPixelColor(i) == c) return;
+		LedStripFeature::applyPixelColor(pixels, i, c);
+		markDirty(i, i+1);
+	}
+	RgbColor GetPixelColor(uint16_t i) const {
+		if (i >= count) return RgbColor(0);
+		if (parent) return parent->GetPixelColor(offset + ((flags & LED_FRAME_REVERSE)? count-1-i : i));
+		return LedStripFeature::retrievePixelColor(pixels, i);
+	}
+	void ClearTo(RgbColor c);		// Sets every pixel to c
+	void ShiftRight(uint16_t n);	// Moves every pixel n positions up (the last n fall off the end, the first n keep their color)
+
+	bool IsDirty() const { return dirtyStart < dirtyEnd; }	// (Views draw straight into their parent, so only the root frame's dirty range is meaningful)
+	uint16_t getDirtyStart() const { return dirtyStart; }	// First pixel that changed (only valid if IsDirty)
+	uint16_t getDirtyEnd() const { return dirtyEnd; }		// One past the last pixel that changed (only valid if IsDirty)
+	void ResetDirty() { dirtyStart = count; dirtyEnd = 0; }
+	void markDirty(uint16_t start, uint16_t end) {	// Adds pixels [start, end) to the dirty range
+		if (start < dirtyStart) dirtyStart = start;
+		if (end > dirtyEnd) dirtyEnd = end;
+	}
+
+protected:
+	uint8_t* const pixels;
+	LedFrame* const parent;
+	uint16_t offset, length, count;
+	uint8_t flags;
+	uint16_t dirtyStart, dirtyEnd;
+};
+
+#endif
@@ -1,27 +1,40 @@
 /******      LED strip      ******/
 #include "ledStrip.h"
 
-NeoPixelBus<NeoGrbFeature, Neo800KbpsMethod> strip(N_PIXELS, LED_PIN);
-LedStripEffects stripEffects;
+NeoPixelBus<LedStripFeature, LedStripMethod> strip(N_PIXELS, LED_PIN);
+uint8_t stripPixels[N_PIXELS*LedStripFeature::PixelSize];	// What effects drew (linear, full brightness). The output stage turns it into strip's own buffer
+LedFrame stripFrame(stripPixels, N_PIXELS);
+uint8_t ledBrightness = LED_DEFAULT_BRIGHTNESS;
+bool ledDither = LED_DEFAULT_DITHER;
+uint16_t ledOutputLUT[256];	// Input value -> gamma corrected and scaled by ledBrightness output, in 8.8 fixed point
+uint8_t ledDitherFrame = 0;	// Frame counter (its bit-reversal is the dithering threshold)
+bool ledOutputPending = false;	// Whether the output stage needs to push another frame even if stripFrame didn't change (dithering a fractional part, or the limiter relaxing)
+uint16_t ledPowerBudget = LED_DEFAULT_POWER_BUDGET_MA;
+uint16_t ledCurrentEstimate = 0, ledCurrentLimited = 0;
+uint32_t ledLimiterScale = 0x10000;	// Scale (16.16) the output stage applies to stay within ledPowerBudget (0x10000 = not limiting)
+uint32_t ledFramesLimited = 0;
+uint32_t ledFramesRendered = 0, ledFramesPushed = 0;	// Effect iterations vs strip.Show()s (they differ when iterations don't change any pixel, or several happen between two presentFrames)
+uint32_t ledFramesDeferred = 0;	// Number of times presentFrame had a dirty frame but the strip was still sending the previous one
+uint32_t NeoNullMethod::updateCount = 0;
+LedSegment mainSegment("main", 0, N_PIXELS);	// Covers the whole strip unless it's shrunk with mainSegment.setView() to make room for other segments
+LedStripEffects& stripEffects = mainSegment.effects;
+LedSegment* ledSegments[LED_MAX_SEGMENTS] = {&mainSegment};
+uint8_t numLedSegments = 1;
+int8_t ledConfigPersistId = -1;	// stripEffects' playlist, as a persistence target (see markPersistDirty)
+int8_t ledLayoutPersistId = -1;	// Segment layout and the other segments' playlists, as a persistence target
 
 
 /***************************************************/
 /******            SETUP FUNCTIONS            ******/
 /***************************************************/
 void setupLedStrip() {	// Initializes LED strip and the effect list stripEffects
-	stripEffects.loadConfigFromFile();
-
-	stripEffects.clear();
-	stripEffects.addEffect(new EffectVolumeShifter(15000));
-	stripEffects.addEffect(new EffectColorWipe(RgbColor(255,0,0), 30));
-	stripEffects.addEffect(new EffectRainbow());
-	stripEffects.addEffect(new EffectColorWipe(RgbColor(0,255,0), 20));
-	stripEffects.addEffect(new EffectRainbowCycle());
-	stripEffects.addEffect(new EffectColorWipe(RgbColor(0,0,255), 10));
-	stripEffects.addEffect(new EffectTheaterChaseRainbow(3));
-	stripEffects.saveConfigToFile();
+	ledConfigPersistId = addPersistTarget("playlist", LedStripEffects::configFile.c_str(), [](Stream& out) { return stripEffects.writePlaylist(out); }, NULL, LED_CONFIG_SAVE_DELAY, LED_CONFIG_SAVE_MAX_DELAY);
+	ledLayoutPersistId = addPersistTarget("segments", LED_LAYOUT_FILE, writeLedLayout, NULL, LED_CONFIG_SAVE_DELAY, LED_CONFIG_SAVE_MAX_DELAY);
+	stripEffects.loadConfigFromFile();	// (Changes made through webSocketControl are saved back to it in the background)
 	stripEffects.restartEffectList();
+	loadLedLayout();
 	
+	setLedOutput(LED_DEFAULT_BRIGHTNESS, LED_DEFAULT_DITHER);
 	strip.Begin();
 	strip.Show();
 }
@@ -38,28 +51,376 @@ RgbColor intToRgbColor(uint32_t c) {	// Converts a uint32_t back to RgbColor
 	return RgbColor(c&0xFF, (c>>8)&0xFF, (c>>16)&0xFF);
 }
 
-void colorFull(RgbColor c) {	// Fills the whole strip with given color
-	for(uint16_t i=0; i<strip.PixelCount(); i++) {
-		strip.SetPixelColor(i, c);
+void colorFull(RgbColor c) {	// Fills the whole strip with given color (and shows it)
+	stripFrame.ClearTo(c);
+	presentFrame();
+}
+
+RgbColor Wheel(byte WheelPos) {	// Sort of HSV color generation (WheelPos is an approx. of a 0-255 hue value)
+	return paletteRainbow.get(WheelPos);	// (Precomputed, see paletteRainbowRGB)
+}
+
+LedSegment* addLedSegment(const char* name, uint16_t offset, uint16_t length, uint8_t flags) {	// Creates a segment covering pixels [offset, offset+length) of the strip (flags: LED_FRAME_REVERSE, LED_FRAME_MIRROR). Returns NULL if there's no room left or the name is taken
+	if (numLedSegments >= LED_MAX_SEGMENTS || getLedSegment(name)) {
+		consolePrintF("Can't add LED segment %s (%d/%d segments in use, or the name is taken) :(\n", name, numLedSegments, LED_MAX_SEGMENTS);
+		return NULL;
 	}
+
+	LedSegment* segment = new LedSegment(name, offset, length, flags);
+	ledSegments[numLedSegments++] = segment;
+	return segment;
+}
+
+LedSegment* getLedSegment(const char* name) {	// Returns the segment called name (or NULL)
+	for (uint8_t i=0; i<numLedSegments; ++i) {
+		if (strncmp(ledSegments[i]->name, name, LED_SEGMENT_NAME_LEN-1) == 0) return ledSegments[i];
+	}
+	return NULL;
+}
+
+bool removeLedSegment(const char* name) {	// Deletes the segment called name (mainSegment can't be removed). Its pixels keep their last color until some other segment draws on them
+	for (uint8_t i=1; i<numLedSegments; ++i) {
+		if (strncmp(ledSegments[i]->name, name, LED_SEGMENT_NAME_LEN-1) == 0) {
+			delete ledSegments[i];
+			memmove(&ledSegments[i], &ledSegments[i+1], (numLedSegments-i-1)*sizeof(ledSegments[0]));
+			--numLedSegments;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool writeLedLayout(Stream& out) {	// Writes the view and layers of every segment and every effect list but stripEffects to out (see loadLedLayout). Returns false if out couldn't take it all
+	/* Layout format (little endian):
+	 *	LED_LAYOUT_MAGIC, version (uint8_t), number of segments (uint8_t, mainSegment first)
+	 *	For every segment: name length (uint8_t), name, offset (uint16_t), length (uint16_t), flags (uint8_t), number of layers (uint8_t)
+	 *		For every layer: LedBlendMode (uint8_t), alpha (uint8_t)
+	 *	CRC-32 of everything above (uint32_t)
+	 *	For every segment: its effect list (except mainSegment's, which is stripEffects and has its own file), then the effect list of each of its layers, as playlists
+	 */
+	CrcFile crcOut(out);
+	bool ok = crcOut.write(LED_LAYOUT_MAGIC, sizeof(LED_LAYOUT_MAGIC)-1) && crcOut.write((uint8_t)LED_LAYOUT_VERSION) && crcOut.write(numLedSegments);
+	for (uint8_t i=0; i<numLedSegments; ++i) {
+		const LedSegment* segment = ledSegments[i];
+		const uint8_t len = strlen(segment->name);
+		ok = ok && crcOut.write(len) && crcOut.write(segment->name, len) && crcOut.write(segment->frame.getOffset()) && crcOut.write(segment->frame.getLength()) && crcOut.write(segment->frame.getFlags()) && crcOut.write(segment->getNumLayers());
+		for (uint8_t l=0; l<segment->getNumLayers(); ++l) {
+			const LedLayer* layer = segment->getLayer(l);
+			ok = ok && crcOut.write((uint8_t)layer->blendMode) && crcOut.write(layer->alpha);
+		}
+	}
+	const uint32_t crc = crcOut.crc;
+	ok = ok && out.write((const uint8_t*)&crc, sizeof(crc)) == sizeof(crc);
+	for (uint8_t i=0; i<numLedSegments; ++i) {
+		const LedSegment* segment = ledSegments[i];
+		if (i > 0) ok = ok && ledSegments[i]->effects.writePlaylist(out);
+		for (uint8_t l=0; l<segment->getNumLayers(); ++l) {
+			ok = ok && segment->getLayer(l)->effects.writePlaylist(out);
+		}
+	}
+	return ok;
+}
+
+bool loadLedLayout(String path) {	// Recreates the segments (and their layers) saved by writeLedLayout. If the file is missing or corrupt only mainSegment is left, covering the whole strip
+	recoverFile(path);
+	File f = SPIFFS.open(path, "r");
+	if (!f) return false;	// (No segments were ever added)
+
+	struct {
+		char name[LED_SEGMENT_NAME_LEN];
+		uint16_t offset, length;
+		uint8_t flags, numLayers;
+		uint8_t blendMode[LED_MAX_LAYERS], alpha[LED_MAX_LAYERS];
+	} views[LED_MAX_SEGMENTS];	// Read (and checked) first, so a corrupt file doesn't leave half a layout
+	CrcFile in(f);
+	char magic[sizeof(LED_LAYOUT_MAGIC)-1];
+	uint8_t version, n;
+	bool ok = in.read(magic, sizeof(magic)) && memcmp(magic, LED_LAYOUT_MAGIC, sizeof(magic)) == 0 && in.read(version) && version == LED_LAYOUT_VERSION && in.read(n) && n >= 1 && n <= LED_MAX_SEGMENTS;
+	for (uint8_t i=0; i<n && ok; ++i) {
+		uint8_t len;
+		ok = in.read(len) && len < LED_SEGMENT_NAME_LEN && in.read(views[i].name, len) && in.read(views[i].offset) && in.read(views[i].length) && in.read(views[i].flags) && in.read(views[i].numLayers) && views[i].numLayers <= LED_MAX_LAYERS;
+		views[i].name[ok? len:0] = '\0';
+		for (uint8_t l=0; l<views[i].numLayers && ok; ++l) {
+			ok = in.read(views[i].blendMode[l]) && views[i].blendMode[l] < N_LED_BLEND_MODES && in.read(views[i].alpha[l]);
+		}
+	}
+	uint32_t crc = in.crc, storedCrc;
+	if (!ok || f.read((uint8_t*)&storedCrc, sizeof(storedCrc)) != sizeof(storedCrc) || storedCrc != crc) {
+		consolePrintF("LED segment layout %s is not a version %d layout, or it's corrupt :(\n", path.c_str(), LED_LAYOUT_VERSION);
+		return false;
+	}
+
+	LedStripEffects discarded;	// (The playlists of a segment or layer that can't be recreated still have to be read to get to the next one)
+	mainSegment.setView(views[0].offset, views[0].length, views[0].flags);
+	for (uint8_t i=0; i<n && ok; ++i) {
+		LedSegment* segment = (i == 0)? &mainSegment : addLedSegment(views[i].name, views[i].offset, views[i].length, views[i].flags);
+		if (i > 0) {
+			ok = (segment? segment->effects : discarded).readPlaylist(f, path);	// (The playlists after a corrupt one can't be found either)
+			if (ok && segment) segment->effects.restartEffectList();
+		}
+		for (uint8_t l=0; l<views[i].numLayers && ok; ++l) {
+			LedLayer* layer = segment? segment->addLayer((LedBlendMode)views[i].blendMode[l], views[i].alpha[l]) : NULL;
+			ok = (layer? layer->effects : discarded).readPlaylist(f, path);
+			if (ok && layer) layer->effects.restartEffectList();
+		}
+	}
+	consolePrintF("Loaded %d LED segment(s) from %s\n", numLedSegments, path.c_str());
+	return true;
+}
+
+void setLedPowerBudget(uint16_t mA) {	// Sets the max current (mA) the strip may draw (0 = no limit)
+	ledPowerBudget = mA;
+	if (mA == 0) ledLimiterScale = 0x10000;	// Without a budget there's nothing to relax towards: stop dimming right away
+	stripFrame.markDirty(0, N_PIXELS);	// Every pixel needs to be rescaled
+}
+
+void setLedOutput(uint8_t brightness, bool dither) {	// Sets the global brightness and dithering of the output stage (and rebuilds its LUT)
+	ledBrightness = brightness;
+	ledDither = dither;
+	for (uint16_t v=0; v<256; ++v) {	// (Only runs when the settings change, so pow is fine here)
+		ledOutputLUT[v] = pow(v/255.0, LED_GAMMA)*brightness*256 + 0.5;	// v=255 and brightness=255 -> 255.0
+	}
+	stripFrame.markDirty(0, N_PIXELS);	// Every pixel needs to go through the new LUT
+}
+
+uint32_t outputPass(uint16_t start, uint16_t end, uint32_t scale) {	// Writes pixels [start, end) of stripFrame to strip's buffer through ledOutputLUT, scale (16.16) and dithering. Returns the sum of the LUT values (before scale) for the current estimate
+	const uint8_t S = LedStripFeature::PixelSize;
+	const uint8_t* src = stripPixels + start*S;
+	uint8_t* dst = strip.Pixels() + start*S;
+
+	uint8_t threshold = 0, phaseStep = 0;	// (No dithering: always round down)
+	if (ledDither) {
+		threshold = ledDitherFrame;	// Bit-reversed frame counter: over 256 frames every threshold is used once, evenly spread (so a 0.25 fraction rounds up every 4th frame, not 64 frames in a row)
+		threshold = (threshold & 0xF0) >> 4 | (threshold & 0x0F) << 4;
+		threshold = (threshold & 0xCC) >> 2 | (threshold & 0x33) << 2;
+		threshold = (threshold & 0xAA) >> 1 | (threshold & 0x55) << 1;
+		threshold += start*167;
+		phaseStep = 167;	// Different phase on every pixel so neighbours don't flicker in sync
+	}
+
+	uint32_t sum = 0;
+	uint8_t fractions = 0;
+	for (uint16_t i=start; i<end; ++i, threshold+=phaseStep) {
+		for (uint8_t c=0; c<S; ++c) {
+			const uint16_t v = ledOutputLUT[*src++];
+			const uint16_t scaled = ((uint32_t)v*scale) >> 16;
+			sum += v;
+			fractions |= (uint8_t)scaled;
+			*dst++ = ((uint32_t)scaled + threshold) >> 8;	// (scaled <= 255*256, so it can't go over 255)
+		}
+	}
+	ledOutputPending = ledDither && fractions;
+	return sum;
+}
+
+void applyOutputStage(uint16_t start, uint16_t end) {	// Writes pixels [start, end) of stripFrame to strip's buffer through the gamma+brightness LUT, the power limiter and dithering
+	++ledDitherFrame;
+	uint32_t sum = outputPass(start, end, (ledPowerBudget > 0)? ledLimiterScale : 0x10000);
+	if (start > 0 || end < N_PIXELS) return;	// Can only estimate the current from a whole frame (presentFrame only sends part of it if dithering and the limiter are off)
+
+	const uint32_t idle = N_PIXELS*LED_MA_IDLE;
+	const uint32_t channels = (uint64_t)sum*LED_MA_PER_CHANNEL / (255*256);	// (mA) Every channel draws LED_MA_PER_CHANNEL at 255
+	ledCurrentEstimate = min(idle + channels, (uint32_t)0xFFFF);
+
+	uint32_t scale = 0x10000;
+	if (ledPowerBudget > 0 && idle + channels > ledPowerBudget) {	// Dim the whole frame evenly so the channels fit in what's left after the idle current
+		scale = (ledPowerBudget > idle)? ((uint64_t)(ledPowerBudget - idle) << 16) / channels : 0;
+	}
+	const uint32_t applied = min(scale, ledLimiterScale);
+	if (scale < ledLimiterScale) {	// The frame got brighter than the current scale allows: redo it before it's shown
+		outputPass(start, end, scale);
+	} else if (scale > ledLimiterScale) {	// Dimmer: this frame is within budget already, push another one at the relaxed scale
+		ledOutputPending = true;
+	}
+	ledLimiterScale = scale;
+	ledCurrentLimited = idle + (((uint64_t)channels*applied) >> 16);
+	if (applied < 0x10000) ++ledFramesLimited;
+}
+
+void presentFrame() {	// Pushes stripFrame to the strip through the output stage (at most one Show per call, and only if any pixel changed since the last one or the output stage needs another frame)
+	if (!stripFrame.IsDirty() && !ledOutputPending) return;
+	if (!strip.CanShow()) {	// DMA/async methods send the frame in the background from their own buffer (so the next frame can be drawn meanwhile), but Show would block until they're done: keep the frame dirty and present it next time
+		if (stripFrame.IsDirty()) ++ledFramesDeferred;
+		return;
+	}
+
+	if (ledDither || ledPowerBudget > 0 || ledOutputPending) {	// Every pixel's rounding changes from frame to frame, the limiter needs to see the whole frame, and a pending frame (eg: the limiter relaxing) has to redo every pixel, not just the dirty ones
+		applyOutputStage(0, N_PIXELS);
+	} else {
+		applyOutputStage(stripFrame.getDirtyStart(), stripFrame.getDirtyEnd());
+	}
+	strip.Dirty();
 	strip.Show();
+	stripFrame.ResetDirty();
+	++ledFramesPushed;
 }
 
-RgbColor Wheel(byte WheelPos) {	// Sort of HSV color generation (WheelPos is an approx. of a 0-255 hue value)
-	WheelPos = 255 - WheelPos;
-	if(WheelPos < 85) {
-		return RgbColor(255 - WheelPos * 3, 0, WheelPos * 3);
+void processLedStrip() {	// "LEDstrip.loop()" function: executes an iteration of the current effect of every segment and presents the resulting frame
+	for (uint8_t i=0; i<numLedSegments; ++i) {
+		ledSegments[i]->loop();
 	}
-	if(WheelPos < 170) {
-		WheelPos -= 85;
-		return RgbColor(0, WheelPos * 3, 255 - WheelPos * 3);
+	presentFrame();
+}
+
+String ledLayoutJson() {	// Describes every segment and its layers as JSON (for the replies of runLedControlCommand)
+	String json = F("[");
+	for (uint8_t i=0; i<numLedSegments; ++i) {
+		const LedSegment* segment = ledSegments[i];
+		if (i > 0) json += ',';
+		json += SF("{\"segment\":\"") + segment->name + F("\",\"offset\":") + segment->frame.getOffset() + F(",\"length\":") + segment->frame.getLength() + F(",\"flags\":") + segment->frame.getFlags() + F(",\"numEffects\":") + segment->effects.getNumEffects() + F(",\"layers\":[");
+		for (uint8_t l=0; l<segment->getNumLayers(); ++l) {
+			const LedLayer* layer = segment->getLayer(l);
+			if (l > 0) json += ',';
+			json += SF("{\"blend\":") + layer->blendMode + F(",\"alpha\":") + layer->alpha + F(",\"numEffects\":") + layer->effects.getNumEffects() + '}';
+		}
+		json += F("]}");
 	}
-	WheelPos -= 170;
-	return RgbColor(WheelPos * 3, 255 - WheelPos * 3, 0);
+	return json + ']';
 }
 
-void processLedStrip() {	// "LEDstrip.loop()" function: executes an iteration of the current effect
-	stripEffects.loop();
+const char* runLedLayoutCommand(JsonObject& cmd, const char* op, bool& handled) {	// Runs the segment and layer commands of runLedControlCommand (sets handled to false if op isn't one of them). Returns an error message (PROGMEM) or NULL if it went fine
+	handled = true;
+	const char* name = cmd["segment"];
+	LedSegment* segment = name? getLedSegment(name) : NULL;
+	const uint16_t offset = cmd.containsKey("offset")? cmd["offset"].as<uint16_t>() : segment? segment->frame.getOffset() : 0;
+	const uint16_t length = cmd.containsKey("length")? cmd["length"].as<uint16_t>() : segment? segment->frame.getLength() : N_PIXELS-offset;
+	const uint8_t flags = cmd.containsKey("flags")? cmd["flags"].as<uint8_t>() : segment? segment->frame.getFlags() : 0;
+	const bool validView = (length > 0 && offset < N_PIXELS && length <= N_PIXELS-offset && !(flags & ~(LED_FRAME_REVERSE|LED_FRAME_MIRROR)));
+
+	if (strcmp_P(op, PSTR("segments")) == 0) {
+		return NULL;
+	} else if (strcmp_P(op, PSTR("addSegment")) == 0) {
+		if (!name || !name[0] || strlen(name) >= LED_SEGMENT_NAME_LEN || strpbrk(name, "\"\\")) return PSTR("Invalid segment name");	// (It's echoed back in JSON)
+		if (!validView) return PSTR("Segment out of the strip");
+		segment = addLedSegment(name, offset, length, flags);
+		if (!segment) return PSTR("Too many segments, or the name is taken");
+		segment->effects.restartEffectList();
+	} else if (strcmp_P(op, PSTR("setSegment")) == 0) {
+		if (!segment) return PSTR("Unknown segment");
+		if (!validView) return PSTR("Segment out of the strip");
+		if (!segment->setView(offset, length, flags)) return PSTR("Remove the segment's layers to change its length");
+	} else if (strcmp_P(op, PSTR("removeSegment")) == 0) {
+		if (!segment) return PSTR("Unknown segment");
+		if (!removeLedSegment(name)) return PSTR("The main segment can't be removed");
+	} else if (strcmp_P(op, PSTR("addLayer")) == 0 || strcmp_P(op, PSTR("setLayer")) == 0 || strcmp_P(op, PSTR("removeLayer")) == 0) {
+		if (!name) segment = &mainSegment;	// (Like the effect commands)
+		if (!segment) return PSTR("Unknown segment");
+		const bool add = (strcmp_P(op, PSTR("addLayer")) == 0);
+		LedLayer* layer = cmd.containsKey("layer")? segment->getLayer(cmd["layer"]) : NULL;
+		if (!add && !layer) return PSTR("Unknown layer");
+		const uint8_t blendMode = cmd.containsKey("blend")? cmd["blend"].as<uint8_t>() : add? LED_BLEND_ADD : layer->blendMode;
+		const uint8_t alpha = cmd.containsKey("alpha")? cmd["alpha"].as<uint8_t>() : add? 255 : layer->alpha;
+		if (blendMode >= N_LED_BLEND_MODES) return PSTR("Unknown blend mode");
+
+		if (add) {
+			layer = segment->addLayer((LedBlendMode)blendMode, alpha);
+			if (!layer) return PSTR("Too many layers, or not enough heap");
+			layer->effects.restartEffectList();
+		} else if (strcmp_P(op, PSTR("setLayer")) == 0) {	// Shows up on the next frame
+			layer->blendMode = (LedBlendMode)blendMode;
+			layer->alpha = alpha;
+			layer->frame.markDirty(0, layer->frame.PixelCount());
+		} else {
+			segment->removeLayer(cmd["layer"]);
+		}
+	} else {
+		handled = false;
+		return NULL;
+	}
+	markPersistDirty(ledLayoutPersistId);
+	return NULL;
+}
+
+String runLedControlCommand(char* json) {	// Runs a control command (compact JSON, see webSocketControl) on an effect list right away and returns the reply (JSON)
+	/* Commands ("n" is the position of an effect in the list and defaults to the current one; "segment" picks that segment's list instead of stripEffects, and "layer" one of its layers' lists):
+	 *	{"cmd":"list"}											Also replies with every effect and its settings
+	 *	{"cmd":"add","effect":"Chase","at":2,"params":{...}}	Inserts a new effect ("at" defaults to the end) with the settings in "params" (see LedStripEffect::loadConfigFromJson)
+	 *	{"cmd":"remove","n":2}
+	 *	{"cmd":"move","n":1,"to":3}
+	 *	{"cmd":"skip","to":3}									Jumps to effect "to" (defaults to the next one)
+	 *	{"cmd":"set","n":1,"params":{"color":16711680,"tickInterval":30}}
+	 * Segment commands (they all reply with every segment and its layers, see ledLayoutJson; a new segment starts with an empty list):
+	 *	{"cmd":"segments"}
+	 *	{"cmd":"addSegment","segment":"ambient","offset":0,"length":100,"flags":0}	"flags": LED_FRAME_REVERSE|LED_FRAME_MIRROR
+	 *	{"cmd":"setSegment","segment":"main","offset":100,"length":350}				Moves/resizes a segment (missing keys keep their value)
+	 *	{"cmd":"removeSegment","segment":"ambient"}
+	 * Layer commands ("segment" defaults to mainSegment; a new layer starts with an empty list, which "layer" picks in the effect commands above):
+	 *	{"cmd":"addLayer","segment":"main","blend":1,"alpha":128}	"blend": LedBlendMode (defaults to LED_BLEND_ADD), "alpha" defaults to 255
+	 *	{"cmd":"setLayer","segment":"main","layer":0,"alpha":64}	Changes the blend mode and/or alpha of a layer (missing keys keep their value)
+	 *	{"cmd":"removeLayer","segment":"main","layer":0}
+	 */
+	ConfigJson config;
+	JsonObject& cmd = config.parse(json);
+	if (!cmd.success()) return SF("{\"ok\":false,\"error\":\"Invalid JSON\"}");
+	const char* op = cmd["cmd"];
+	if (!op) op = "";
+
+	bool handled;
+	const char* error = runLedLayoutCommand(cmd, op, handled);
+	if (handled) {
+		if (error) return SF("{\"ok\":false,\"error\":\"") + FPSTR(error) + F("\"}");
+		return SF("{\"ok\":true,\"segments\":") + ledLayoutJson() + '}';
+	}
+
+	LedSegment* segment = cmd.containsKey("segment")? getLedSegment(cmd["segment"]) : &mainSegment;
+	if (!segment) return SF("{\"ok\":false,\"error\":\"Unknown segment\"}");
+	LedLayer* layer = cmd.containsKey("layer")? segment->getLayer(cmd["layer"]) : NULL;
+	if (cmd.containsKey("layer") && !layer) return SF("{\"ok\":false,\"error\":\"Unknown layer\"}");
+	LedStripEffects& effects = layer? layer->effects : segment->effects;
+	const uint8_t n = cmd.containsKey("n")? cmd["n"].as<uint8_t>() : effects.getCurrEffect();
+	const bool list = (strcmp_P(op, PSTR("list")) == 0);
+	bool changed = true;	// Whether the list or its settings changed (and need to be saved)
+
+	if (list) {
+		changed = false;
+	} else if (strcmp_P(op, PSTR("add")) == 0) {
+		const char* name = cmd["effect"];
+		LedStripEffect* effect = name? LedStripEffect::fromEffectName(name) : NULL;
+		if (!effect) {
+			error = PSTR("Unknown effect");
+		} else if (effects.getNumEffects() >= 255) {	// (A playlist stores the number of effects as uint8_t)
+			delete effect;
+			error = PSTR("Effect list full");
+		} else {
+			effect->loadConfigFromJson(cmd["params"].as<JsonObject&>());
+			effects.insertEffect(effect, cmd.containsKey("at")? cmd["at"].as<uint8_t>() : 255);
+		}
+	} else if (strcmp_P(op, PSTR("remove")) == 0) {
+		if (n < effects.getNumEffects()) effects.removeEffect(n, false);
+		else error = PSTR("No such effect");
+	} else if (strcmp_P(op, PSTR("move")) == 0) {
+		if (!cmd.containsKey("to") || !effects.moveEffect(n, cmd["to"])) error = PSTR("No such effect");
+	} else if (strcmp_P(op, PSTR("skip")) == 0) {
+		changed = false;
+		if (!cmd.containsKey("to")) effects.nextEffect();
+		else if (cmd["to"].as<uint8_t>() < effects.getNumEffects()) effects.playEffect(cmd["to"]);
+		else error = PSTR("No such effect");
+	} else if (strcmp_P(op, PSTR("set")) == 0) {
+		LedStripEffect* effect = effects.getEffect(n);
+		if (effect) effect->loadConfigFromJson(cmd["params"].as<JsonObject&>());	// Effects read their settings on every iteration, so the change shows up on the next frame
+		else error = PSTR("No such effect");
+	} else {
+		error = PSTR("Unknown cmd");
+	}
+
+	if (error) return SF("{\"ok\":false,\"error\":\"") + FPSTR(error) + F("\"}");
+	if (changed) markPersistDirty((&effects == &stripEffects)? ledConfigPersistId : ledLayoutPersistId);	// (The other lists, segments' and layers', are saved with the layout)
+
+	String reply = SF("{\"ok\":true,\"curr\":") + effects.getCurrEffect() + F(",\"numEffects\":") + effects.getNumEffects();
+	if (list) {	// Built by hand: a long list wouldn't fit in the ConfigJson arena
+		reply += F(",\"effects\":[");
+		for (uint8_t i=0; i<effects.getNumEffects(); ++i) {
+			LedStripEffect* effect = effects.getEffect(i);
+			if (i > 0) reply += ',';
+			reply += SF("{\"effectName\":\"") + effect->getCompressedEffectName() + '"';
+			for (uint8_t p=0; p<effect->getNumParams(); ++p) {
+				reply += SF(",\"") + effect->getParam(p).key + F("\":") + effect->getParamValue(p);
+			}
+			reply += '}';
+		}
+		reply += ']';
+	}
+	return reply + '}';
 }
 
 
@@ -67,47 +428,114 @@ void processLedStrip() {	// "LEDstrip.loop()" function: executes an iteration of
 /******           LED strip effects           ******/
 /***************************************************/
 /**********************      LedStripEffect      **********************/
-const char PROGMEM LedStripEffect::strCompressedEffectName[] = {""};
-const char PROGMEM LedStripEffect::strReadableEffectName  [] = {""};
-const char PROGMEM LedStripEffect::strReadableEffectDesc  [] = {""};
-
-LedStripEffect* LedStripEffect::fromEffectName(String effectName) {	// (Dynamically) creates a new LedStripEffect of the right derived class based on effectName and passes configPath to its constructor
-	if        (effectName == FPSTR(EffectColorWipe::strCompressedEffectName)) {
-		return new EffectColorWipe();
-	} else if (effectName == FPSTR(EffectRainbow::strCompressedEffectName)) {
-		return new EffectRainbow();
-	} else if (effectName == FPSTR(EffectRainbowCycle::strCompressedEffectName)) {
-		return new EffectRainbowCycle();
-	} else if (effectName == FPSTR(EffectTheaterChase::strCompressedEffectName)) {
-		return new EffectTheaterChase();
-	} else if (effectName == FPSTR(EffectTheaterChaseRainbow::strCompressedEffectName)) {
-		return new EffectTheaterChaseRainbow();
-	} else if (effectName == FPSTR(EffectVolumeShifter::strCompressedEffectName)) {
-		return new EffectVolumeShifter();
+const LedEffectParam LedStripEffect::baseParams[] = {
+	LED_EFFECT_PARAM(LedStripEffect, tickInterval, LED_PARAM_U16),
+	LED_EFFECT_PARAM(LedStripEffect, numLoops, LED_PARAM_U8),
+	LED_EFFECT_PARAM_AS("transition", LedStripEffect, transitionType, LED_PARAM_U8),
+	LED_EFFECT_PARAM_AS("transitionMs", LedStripEffect, transitionDuration, LED_PARAM_U16),
+};
+const uint8_t LedStripEffect::numBaseParams = sizeof(baseParams)/sizeof(baseParams[0]);
+
+LedStripEffect* LedStripEffect::fromEffectName(const char* effectName) {	// (Dynamically) creates a new LedStripEffect of the right derived class based on effectName (NULL if unknown)
+	if (!effectName) return NULL;
+
+	const LedEffectInfo* info;
+	switch (fnv1a(effectName)) {	// One hash instead of comparing effectName against every name (two classes with the same hash wouldn't compile: duplicate case)
+		case EffectColorWipe::nameHash:				info = &EffectColorWipe::info; break;
+		case EffectRainbow::nameHash:				info = &EffectRainbow::info; break;
+		case EffectRainbowCycle::nameHash:			info = &EffectRainbowCycle::info; break;
+		case EffectTheaterChase::nameHash:			info = &EffectTheaterChase::info; break;
+		case EffectTheaterChaseRainbow::nameHash:	info = &EffectTheaterChaseRainbow::info; break;
+		case EffectVolumeShifter::nameHash:			info = &EffectVolumeShifter::info; break;
+		default:									return NULL;
 	}
-
-	return NULL;
+	if (strcmp(effectName, info->compressedName) != 0) return NULL;	// Unknown name that happens to have the same hash as a known one
+	return info->create();
 }
 
 LedStripEffect* LedStripEffect::fromJson(String configPath) {	// (Dynamically) creates and configures a new LedStripEffect of the right derived class based on the contents of the supplied JSON configuration file
-	std::unique_ptr<char[]> buf = readFile(configPath);
-	if (!buf) return NULL;	// Only parse the JSON if readFile succeeded (it will print errors to the console if not)
-	
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.parseObject(buf.get());
-	if (!json.success()) {
-		consolePrintF("Failed to parse JSON config file %s :(\n", configPath.c_str());
-		return NULL;
-	}
+	ConfigJson config;
+	JsonObject& json = config.load(configPath);
+	if (!json.success()) return NULL;	// (load prints the errors to the console)
 
 	LedStripEffect* effect = LedStripEffect::fromEffectName(json["effectName"]);
-	if (effect) effect->loadConfigFromJson(json);	// (pure virtual function) Load the effect settings based on the specific effect class implementation
+	if (effect) effect->loadConfigFromJson(json);	// Load the effect settings based on the schema of its class
 //	if (effect) consolePrintF("Loaded %s" + effect->toString() + " from " + configPath + "\n");
 	return effect;
 }
 
+int8_t LedStripEffect::findParam(const char* key) const {	// Index of the setting called key (-1 if there's none)
+	for (uint8_t n=0; n<getNumParams(); ++n) {
+		if (strcmp(getParam(n).key, key) == 0) return n;
+	}
+	return -1;
+}
+
+uint32_t LedStripEffect::getParamValue(uint8_t n) {	// Value of the n-th setting (colors as rgbColorToInt)
+	const LedEffectParam& param = getParam(n);
+	void* field = param.field(this);
+	switch (param.type) {
+		case LED_PARAM_U8:		return *(uint8_t*)field;
+		case LED_PARAM_U16:		return *(uint16_t*)field;
+		case LED_PARAM_U32:		return *(uint32_t*)field;
+		case LED_PARAM_COLOR:	return rgbColorToInt(*(RgbColor*)field);
+	}
+	return 0;
+}
+
+void LedStripEffect::setParamValue(uint8_t n, uint32_t value) {	// Sets the n-th setting (colors as rgbColorToInt)
+	const LedEffectParam& param = getParam(n);
+	void* field = param.field(this);
+	switch (param.type) {
+		case LED_PARAM_U8:		*(uint8_t*)field = value; break;
+		case LED_PARAM_U16:		*(uint16_t*)field = value; break;
+		case LED_PARAM_U32:		*(uint32_t*)field = value; break;
+		case LED_PARAM_COLOR:	*(RgbColor*)field = intToRgbColor(value); break;
+	}
+}
+
+bool LedStripEffect::loadConfigFromJson(JsonObject& json) {	// Loads every setting in the effect's schema found in json (missing ones keep their current value)
+	for (uint8_t n=0; n<getNumParams(); ++n) {
+		const char* key = getParam(n).key;
+		if (json.containsKey(key)) setParamValue(n, json[key].as<uint32_t>());
+	}
+
+	return true;
+}
+
+void LedStripEffect::saveConfigToJson(JsonObject& json) {	// Stores the effect name and every setting in its schema in json
+	json["effectName"] = getInfo().compressedName;	// (Static strings: ArduinoJson only keeps the pointer, no copies)
+	for (uint8_t n=0; n<getNumParams(); ++n) {
+		json[getParam(n).key] = getParamValue(n);
+	}
+}
+
+bool LedStripEffect::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
+	ConfigJson config;
+	JsonObject& json = config.create();
+	saveConfigToJson(json);
+
+	return config.save(json, configPath);
+}
+
+String LedStripEffect::toString() {	// Returns a String description of the state of the effect (name and the value of every setting)
+	String s = getReadableEffectName() + " (";
+	for (uint8_t n=0; n<getNumParams(); ++n) {
+		if (n > 0) s += "; ";
+		s += getParam(n).key;
+		s += ':';
+		if (getParam(n).type == LED_PARAM_COLOR) {
+			RgbColor c = intToRgbColor(getParamValue(n));
+			s += String('[') + c.R + ',' + c.G + ',' + c.B + ']';
+		} else {
+			s += getParamValue(n);
+		}
+	}
+	return s + ')';
+}
+
 void LedStripEffect::preEffectReset(bool resetCntLoops) {	// Resets all effect related variables before executing the first iteration of the effect
-	strip.ClearTo(RgbColor(0));	// Clear screen (some effects assume the strip to be off before starting)
+	frame->ClearTo(RgbColor(0));	// Clear screen (some effects assume the strip to be off before starting)
 	tNextIteration = curr_time;	// Initialize tNextIteration to guarantee at least one iteration of the effect right now
 	resetCounters();			// Reset any effect-specific counters to make sure it starts from the beginning
 	if (resetCntLoops)
@@ -115,125 +543,286 @@ void LedStripEffect::preEffectReset(bool resetCntLoops) {	// Resets all effect r
 	consolePrintF("About to start iteration %d/%d of %s\n", cntLoops+1, numLoops, toString().c_str());
 }
 
-bool LedStripEffect::loop() {	// Runs as many iterations of the effect as needed based on current time and then returns whether the effect is done (true) or not (false)
-	while (curr_time >= tNextIteration) {	// If tickInterval is too small (compared to how often loop() gets called), might be necessary to perform more than one iteration -> "while" instead of "if"
-		if (tickInterval == (uint16_t)-1) {	// tickInterval=-1 is a special case, it indicates we only want the effect to be executed once per LedStripEffect::loop call (instead of every tickInterval ms)
-			tNextIteration = curr_time + 1;	// so set tNextIteration to curr_time+1, to make sure we exit the while loop after one execution of the effect
-		} else {
-			tNextIteration += tickInterval;	// Otherwise, for a regular iterval'd effect, compute the "due date" for the next iteration
-		}
-		didOneIter = false;					// Initialize didOneIter to false (effectFunc will use this aux var to return right after performing one effect iteration)
-		
-		if (effectFunc()) {					// Perform one iteration of the effect
-			consolePrintF("%s finished iteration %d/%d!\n", getReadableEffectName().c_str(), cntLoops+1, numLoops);
-			cntLoops++;						// Increase the "full effect" counter
-			if (cntLoops >= numLoops) {		// Check if we've completed the desired number of "full iterations" of the effect
-				return true;				// (Only) in case that was the last iteration of the last loop of the effect, return true
-			}
-			preEffectReset(false);			// Otherwise, restart the effect: reset all vars/counters EXCEPT for cntLoops (that's what the 'false' is for)
+bool LedStripEffect::loop() {	// Advances the effect to the current time (drawing only the latest state) and then returns whether the effect is done (true) or not (false)
+	if ((int32_t)(curr_time - tNextIteration) < 0) return false;	// Nothing due yet
+
+	uint32_t ticks;
+	if (tickInterval == (uint16_t)-1) {	// tickInterval=-1 is a special case, it indicates we only want the effect to be executed once per LedStripEffect::loop call (instead of every tickInterval ms)
+		ticks = 1;
+		tNextIteration = curr_time + 1;
+	} else {
+		const uint16_t interval = tickInterval? tickInterval:1;	// (It can be set to anything live, see runLedControlCommand)
+		ticks = (curr_time - tNextIteration)/interval + 1;	// Normally 1, more if we stalled (or tickInterval is shorter than the frame interval)
+		tNextIteration += ticks*interval;
+	}
+	if (ticks > LED_EFFECT_MAX_TICKS) ticks = LED_EFFECT_MAX_TICKS;	// Bound the work after a long stall: the effect just skips ahead and tNextIteration is already in sync with the clock
+
+	++ledFramesRendered;
+	if (step(ticks)) {
+		consolePrintF("%s finished iteration %d/%d!\n", getReadableEffectName().c_str(), cntLoops+1, numLoops);
+		cntLoops++;							// Increase the "full effect" counter
+		if (cntLoops >= numLoops) {			// Check if we've completed the desired number of "full iterations" of the effect
+			return true;					// (Only) in case that was the last iteration of the last loop of the effect, return true
 		}
+		preEffectReset(false);				// Otherwise, restart the effect: reset all vars/counters EXCEPT for cntLoops (that's what the 'false' is for)
 	}
-	
+
 	return false;							// Effect not done yet, but nothing else to execute for now
 }
 
 
 /**********************      LedStripEffects      **********************/
 const String LedStripEffects::configFolder("/ledEffects");					// Indicates the path to the folder where all the effect-related config files is stored in the SPIFFS
-const String LedStripEffects::configFile(configFolder + "/numEffects.json");// Indicates the path to the SPIFFS file where we store how many effects we stored in 'configFolder'
-const String LedStripEffects::configFilePrefix(configFolder + "/effect");	// Indicates the prefix for the SPIFFS files containing config settings for each individual effect
+const String LedStripEffects::configFile(configFolder + "/playlist.bin");	// Whole effect list in one versioned, checksummed binary file (see saveConfigToFile)
+const String LedStripEffects::legacyConfigFile(configFolder + "/numEffects.json");// Old layout: how many effects we stored in 'configFolder' (only read to migrate to configFile)
+const String LedStripEffects::configFilePrefix(configFolder + "/effect");	// Old layout: prefix for the SPIFFS files containing config settings for each individual effect
+uint8_t LedStripEffects::transitionPixels[2][N_PIXELS*LedStripFeature::PixelSize];
+LedFrame LedStripEffects::transitionFrom(transitionPixels[0], N_PIXELS);
+LedFrame LedStripEffects::transitionTo(transitionPixels[1], N_PIXELS);
+LedStripEffects* LedStripEffects::transitionOwner = NULL;
 
 void LedStripEffects::loadDefaultEffectList() {	// Loads the default effect list (useful for example if loading the config from file failed)
 	clear();
-	addEffect(new EffectVolumeShifter(30000));
+	addEffect(new EffectVolumeShifter(15000));
+	addEffect(new EffectColorWipe(RgbColor(255,0,0), 30));
+	addEffect(new EffectRainbow());
+	addEffect(new EffectColorWipe(RgbColor(0,255,0), 20));
+	addEffect(new EffectRainbowCycle());
+	addEffect(new EffectColorWipe(RgbColor(0,0,255), 10));
+	addEffect(new EffectTheaterChaseRainbow(3));
 }
 
-bool LedStripEffects::loadConfigFromFile(String configPath) {	// Loads effect list from SPIFFS file located at configPath
+bool LedStripEffects::loadConfigFromFile(String configPath) {	// Loads the effect list from the playlist at configPath (migrating the old layout if there's no playlist yet). Falls back to the default list if neither works
 	consolePrintF("\nTrying to read LED strip effect list config from %s...\n", configPath.c_str());
-	std::unique_ptr<char[]> buf = readFile(configPath);
-	if (!buf) {	// Only parse the JSON if readFile succeeded (it will print errors to the console if not)
-		loadDefaultEffectList();
+	uint32_t tStart = micros();
+	recoverFile(configPath);	// In case power was lost right in the middle of saveConfigToFile
+
+	if (loadPlaylist(configPath)) {
+		consolePrintF("Successfully loaded %d LED strip effects from %s in %lu us!\n\n", listEffects.size(), configPath.c_str(), micros()-tStart);
+		return true;
+	}
+	uint8_t failures = 0;
+	if (SPIFFS.exists(legacyConfigFile) && loadLegacyConfig(failures)) {
+		consolePrintF("Loaded %d LED strip effects from the old layout (%s) in %lu us, migrating them to %s\n", listEffects.size(), legacyConfigFile.c_str(), micros()-tStart, configPath.c_str());
+		if (failures > 0) {	// The playlist is still saved (so we don't migrate again on every boot), but the old files are kept so the effects that failed can be recovered by hand
+			consolePrintF("%d effect(s) couldn't be loaded, keeping the old files in %s\n", failures, configFolder.c_str());
+			saveConfigToFile(configPath);
+		} else if (saveConfigToFile(configPath)) {	// Only delete the old files once the playlist is safely stored
+			Dir dir = SPIFFS.openDir(configFolder);
+			while (dir.next()) {
+				if (dir.fileName() == legacyConfigFile || dir.fileName().startsWith(configFilePrefix)) SPIFFS.remove(dir.fileName());
+			}
+		}
+		return true;
+	}
+
+	loadDefaultEffectList();
+	return false;
+}
+
+bool LedStripEffects::loadPlaylist(String path) {	// Loads the effect list from the playlist at path. The current list is only replaced if the whole file is valid (right magic, version and checksum)
+	File f = SPIFFS.open(path, "r");
+	if (!f) {
+		consolePrintF("Failed to open LED strip playlist %s :(\n", path.c_str());
 		return false;
 	}
-	
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.parseObject(buf.get());
-	if (!json.success()) {
-		consolePrintF("Failed to parse JSON config file %s :(\n\n", configPath.c_str());
-		loadDefaultEffectList();
+	return readPlaylist(f, path);
+}
+
+bool LedStripEffects::readPlaylist(Stream& f, const String& path) {	// Loads the effect list from f in the playlist format (path is only for the console). The current list is only replaced if the whole playlist is valid (right magic, version and checksum)
+	CrcFile in(f);
+	char magic[sizeof(LED_PLAYLIST_MAGIC)-1];
+	uint8_t version, numEffects;
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, LED_PLAYLIST_MAGIC, sizeof(magic)) != 0 || !in.read(version) || version != LED_PLAYLIST_VERSION || !in.read(numEffects)) {
+		consolePrintF("%s is not a version %d LED strip playlist :(\n", path.c_str(), LED_PLAYLIST_VERSION);
 		return false;
 	}
 
-	clear();
-	for (uint8_t i=0; i<json["numEffects"]; ++i) {
-		addEffect(LedStripEffect::fromJson(LedStripEffects::configFilePrefix + String(i) + ".json"));
+	std::vector<LedStripEffect*> effects;	// Parsed here first, so a corrupt file doesn't leave a half-loaded list
+	bool ok = true;
+	for (uint8_t i=0; i<numEffects && ok; ++i) {
+		char name[LED_PLAYLIST_MAX_NAME_LEN+1];
+		uint8_t len, numParams;
+		ok = in.read(len) && len <= LED_PLAYLIST_MAX_NAME_LEN && in.read(name, len) && in.read(numParams);
+		name[ok? len:0] = '\0';
+		LedStripEffect* effect = ok? LedStripEffect::fromEffectName(name) : NULL;
+		if (ok && !effect) consolePrintF("Skipping unknown LED strip effect '%s' in %s\n", name, path.c_str());
+
+		for (uint8_t p=0; p<numParams && ok; ++p) {	// Settings are stored by key, so a class can gain/lose settings without breaking old playlists
+			uint8_t type;
+			uint32_t value = 0;
+			ok = in.read(len) && len <= LED_PLAYLIST_MAX_NAME_LEN && in.read(name, len) && in.read(type) && type <= LED_PARAM_COLOR && in.read(&value, ledEffectParamSize((LedEffectParamType)type));
+			name[ok? len:0] = '\0';
+			int8_t n = (ok && effect)? effect->findParam(name) : -1;
+			if (n >= 0 && effect->getParam(n).type == type) effect->setParamValue(n, value);
+		}
+		if (effect) effects.push_back(effect);
 	}
-	consolePrintF("Successfully loaded LED strip effect list config from %s!\n\n", configPath.c_str());
+
+	uint32_t crc = in.crc, storedCrc;
+	if (!ok || f.readBytes((char*)&storedCrc, sizeof(storedCrc)) != sizeof(storedCrc) || storedCrc != crc) {
+		consolePrintF("LED strip playlist %s is truncated or corrupt :(\n", path.c_str());
+		for (LedStripEffect* effect : effects) delete effect;
+		return false;
+	}
+
+	clear();
+	for (LedStripEffect* effect : effects) addEffect(effect);
 	return true;
 }
 
-bool LedStripEffects::saveConfigToFile(String configPath) {	// Stores current list of effects and their configuration to a SPIFFS JSON file (so settings can be loaded on reboot)
-	// First, delete old config files to avoid issues
-	Dir dir = SPIFFS.openDir(LedStripEffects::configFolder);
-	consolePrintF("\nBefore saving effect list config, I'm going to delete old config files:\n");
-	while (dir.next()) {
-		consolePrintF("\t%s... ", dir.fileName().c_str());
-		if (SPIFFS.remove(dir.fileName())) {
-			consolePrintF("success!\n");
+bool LedStripEffects::loadLegacyConfig(uint8_t& failures) {	// Loads the effect list from the old layout (legacyConfigFile + one JSON file per effect). failures is set to the number of effect files that couldn't be loaded (they're left out of the list)
+	uint8_t numEffects;
+	{	// (Release the arena before fromJson needs it)
+		ConfigJson config;
+		JsonObject& json = config.load(legacyConfigFile);
+		if (!json.success()) return false;	// (load prints the errors to the console)
+		numEffects = json["numEffects"];
+	}
+
+	clear();
+	failures = 0;
+	for (uint8_t i=0; i<numEffects; ++i) {
+		const String path = LedStripEffects::configFilePrefix + String(i) + ".json";
+		LedStripEffect* effect = LedStripEffect::fromJson(path);
+		if (effect) {
+			addEffect(effect);
 		} else {
-			consolePrintF("fail!\n");
+			consolePrintF("Couldn't load effect %d from %s\n", i, path.c_str());
+			++failures;
 		}
 	}
+	return true;
+}
 
-	// Then, actually save JSON files with current effect list config
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
-
-	json["numEffects"] = listEffects.size();
-
-	if (!saveJSON(json, configPath)) {
-		consolePrintF("Couldn't save LED strip effect list! :(\n\n");
+bool LedStripEffects::saveConfigToFile(String configPath) {	// Stores the effect list as a playlist at configPath (written to a temp file first and then renamed, so a crash never leaves a half-written playlist)
+	/* Playlist format (little endian):
+	 *	LED_PLAYLIST_MAGIC, version (uint8_t), number of effects (uint8_t)
+	 *	For every effect: name length (uint8_t), compressed name, number of settings (uint8_t)
+	 *		For every setting: key length (uint8_t), key, LedEffectParamType (uint8_t), value (1, 2 or 4 bytes depending on the type)
+	 *	CRC-32 of everything above (uint32_t)
+	 */
+	const String tmpPath = configPath + FILE_TMP_SUFFIX;
+	File f = SPIFFS.open(tmpPath, "w");
+	if (!f) {
+		consolePrintF("Couldn't save LED strip effect list to %s! :(\n\n", tmpPath.c_str());
 		return false;
 	}
 
-	for (size_t i=0; i<listEffects.size(); ++i) {
-		listEffects[i]->saveConfigToFile(LedStripEffects::configFilePrefix + String(i) + ".json");
-//		consolePrintF("Saved %s\n", listEffects[i]->toString());
+	const bool ok = writePlaylist(f);
+	f.close();
+
+	if (!ok || !replaceFile(tmpPath, configPath)) {
+		consolePrintF("Couldn't save LED strip effect list to %s! :(\n\n", configPath.c_str());
+		SPIFFS.remove(tmpPath);
+		return false;
 	}
 	consolePrintF("Successfully saved LED strip effect list config to %s!\n\n", configPath.c_str());
 	return true;
 }
 
+bool LedStripEffects::writePlaylist(Stream& f) {	// Writes the effect list to f in the playlist format (see saveConfigToFile). Returns false if f couldn't take it all
+	CrcFile out(f);
+	bool ok = out.write(LED_PLAYLIST_MAGIC, sizeof(LED_PLAYLIST_MAGIC)-1) && out.write((uint8_t)LED_PLAYLIST_VERSION) && out.write((uint8_t)listEffects.size());
+	for (LedStripEffect* effect : listEffects) {
+		const char* name = effect->getInfo().compressedName;
+		ok = ok && out.write((uint8_t)strlen(name)) && out.write(name, strlen(name)) && out.write(effect->getNumParams());
+		for (uint8_t n=0; n<effect->getNumParams(); ++n) {
+			const LedEffectParam& param = effect->getParam(n);
+			const uint32_t value = effect->getParamValue(n);
+			ok = ok && out.write((uint8_t)strlen(param.key)) && out.write(param.key, strlen(param.key)) && out.write((uint8_t)param.type) && out.write(&value, ledEffectParamSize(param.type));
+		}
+	}
+	const uint32_t crc = out.crc;
+	return ok && f.write((const uint8_t*)&crc, sizeof(crc)) == sizeof(crc);
+}
+
 void LedStripEffects::restartEffectList() {	// Restarts the effect list: goes back to the first iteration of the first effect
-	currEffect = -1;
-	nextEffect();
+	playEffect(0);
 }
 
 void LedStripEffects::nextEffect() {
+	playEffect(currEffect+1);	// (playEffect wraps around)
+}
+
+void LedStripEffects::playEffect(uint8_t n) {	// Jumps to the n-th effect (through the transition into it)
+	if (isTransitioning()) endTransition();	// Skipping mid-transition: jump to where the previous one was going
+
 	if (listEffects.empty()) {
 		currEffect = 0;
 	} else {	// ***can't "X mod 0" or it'll crash***, so that's why we take different action if list is empty
-		currEffect = (currEffect+1) % listEffects.size();	// Increase the effect counter
-		listEffects[currEffect]->preEffectReset();			// And reset any effect related variables/counters
+		currEffect = n % listEffects.size();
+		LedStripEffect* effect = listEffects[currEffect];
+		if (effect->transitionType != LED_TRANSITION_CUT && effect->transitionDuration > 0 && !transitionOwner && frame->PixelCount() <= N_PIXELS) {
+			beginTransition(effect);						// (Otherwise, cut)
+		}
+		effect->preEffectReset();							// And reset any effect related variables/counters
 	}
 }
 
 void LedStripEffects::addEffect(LedStripEffect* effect) {
-	if (effect) listEffects.push_back(effect);	// Don't add effect if it's NULL ;)
+	if (!effect) return;	// Don't add effect if it's NULL ;)
+	effect->frame = frame;
+	listEffects.push_back(effect);
+}
+
+void LedStripEffects::insertEffect(LedStripEffect* effect, uint8_t n) {	// Takes ownership of effect and inserts it at position n (at the end if n is past it) without interrupting the current effect
+	if (!effect) return;
+	if (n > listEffects.size()) n = listEffects.size();
+	effect->frame = frame;
+	listEffects.insert(listEffects.begin() + n, effect);
+	if (listEffects.size() == 1) {
+		playEffect(0);	// Nothing was playing
+	} else if (n <= currEffect) {
+		++currEffect;
+	}
+}
+
+bool LedStripEffects::moveEffect(uint8_t from, uint8_t to) {	// Moves the from-th effect to position to without interrupting the current effect
+	if (from >= listEffects.size() || to >= listEffects.size()) return false;
+	LedStripEffect* effect = listEffects[from];
+	listEffects.erase(listEffects.begin() + from);
+	listEffects.insert(listEffects.begin() + to, effect);
+
+	if (currEffect == from) {
+		currEffect = to;
+	} else if (from < currEffect && to >= currEffect) {
+		--currEffect;
+	} else if (from > currEffect && to <= currEffect) {
+		++currEffect;
+	}
+	return true;
+}
+
+void LedStripEffects::setFrame(LedFrame* frame) {	// Makes every effect in the list (and the ones added later) draw on frame
+	if (isTransitioning()) endTransition();
+	this->frame = frame;
+	for (LedStripEffect* effect : listEffects) {
+		effect->frame = frame;
+	}
 }
 
-void LedStripEffects::removeEffect(uint8_t n, bool restart) {
+void LedStripEffects::removeEffect(uint8_t n, bool restart) {	// Deletes the n-th effect. If !restart, the list goes on where it was (with the next effect if n was the current one)
 	if (n < listEffects.size()) {
+		if (isTransitioning()) endTransition();	// (The effect being removed might be drawing on transitionTo)
 		delete listEffects[n];
 		listEffects.erase(listEffects.begin() + n);
-		if (restart) restartEffectList();
+		if (restart) {
+			restartEffectList();
+		} else if (n < currEffect) {
+			--currEffect;
+		} else if (n == currEffect) {
+			playEffect(n);	// The next effect took its place
+		}
 	}
 }
 
 void LedStripEffects::clear() {
-	while (!listEffects.empty()) {
-		removeEffect(0, false);
+	if (isTransitioning()) endTransition();
+	for (LedStripEffect* effect : listEffects) {
+		delete effect;
 	}
+	listEffects.clear();
 	currEffect = 0;
 }
 
@@ -243,271 +832,303 @@ void LedStripEffects::loop() {
 			nextEffect();
 		}
 	}
+	if (isTransitioning()) composeTransition();
 }
 
+void LedStripEffects::beginTransition(LedStripEffect* effect) {	// Freezes what's on frame and makes effect draw on transitionTo
+	const uint16_t n = frame->PixelCount();
+	transitionFrom.setCount(n);	// (Both wrap transitionPixels, which fits N_PIXELS)
+	transitionTo.setCount(n);
+	for (uint16_t i=0; i<n; ++i) {	// The old effect is done by now, so its last frame is all there is left to fade out
+		transitionFrom.SetPixelColor(i, frame->GetPixelColor(i));
+	}
 
-/**********************      EffectColorWipe      **********************/
-const char PROGMEM EffectColorWipe::strCompressedEffectName[] = {"ClrWipe"};
-const char PROGMEM EffectColorWipe::strReadableEffectName  [] = {"Color wipe"};
-const char PROGMEM EffectColorWipe::strReadableEffectDesc  [] = {"Fills the strip with a specific color one led at a time from start to end"};
-
-const RgbColor EffectColorWipe::defaultColor = RgbColor(255, 0, 0);
-const uint16_t EffectColorWipe::defaultTickInterval = 20;
-const uint8_t  EffectColorWipe::defaultNumLoops = 1;
+	transitionOwner = this;
+	tTransitionStart = curr_time;
+	effect->frame = &transitionTo;
+}
 
-bool EffectColorWipe::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
+void LedStripEffects::composeTransition() {	// Draws the blend of transitionFrom and transitionTo on frame (and ends the transition once it's over)
+	const LedStripEffect* effect = listEffects[currEffect];
+	const uint32_t elapsed = curr_time - tTransitionStart;
+	if (elapsed >= effect->transitionDuration) {
+		endTransition();
+		return;
+	}
 
-	json["effectName"] = getCompressedEffectName();
-	json["color"] = rgbColorToInt(color);
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
+	const uint8_t progress = elapsed*256 / effect->transitionDuration;	// 0-255
+	const uint8_t S = LedStripFeature::PixelSize;
+	const uint16_t n = transitionTo.PixelCount();
+	const uint16_t wipeEnd = ((uint32_t)n*progress) >> 8;
+	for (uint16_t i=0; i<n; ++i) {
+		const uint8_t* from = transitionPixels[0] + i*S;
+		const uint8_t* to = transitionPixels[1] + i*S;
+		uint8_t px[S];
+		switch (effect->transitionType) {
+			case LED_TRANSITION_WIPE:
+				memcpy(px, (i < wipeEnd)? to:from, S);
+				break;
+			case LED_TRANSITION_DISSOLVE:	// Each pixel switches when progress reaches its own (hashed) threshold
+				memcpy(px, ((uint8_t)((i*2654435761u) >> 24) < progress)? to:from, S);
+				break;
+			default:	// LED_TRANSITION_CROSSFADE
+				for (uint8_t c=0; c<S; ++c) {
+					px[c] = ledBlend(from[c], to[c], LED_BLEND_ALPHA, progress);
+				}
+				break;
+		}
+		frame->SetPixelColor(i, LedStripFeature::retrievePixelColor(px, 0));
+	}
+}
 
-	return saveJSON(json, configPath);
+void LedStripEffects::endTransition() {	// Copies transitionTo to frame and makes the new effect draw on frame again
+	for (uint16_t i=0; i<transitionTo.PixelCount(); ++i) {	// So the effect finds what it drew so far
+		frame->SetPixelColor(i, transitionTo.GetPixelColor(i));
+	}
+	for (LedStripEffect* effect : listEffects) {
+		effect->frame = frame;
+	}
+	transitionOwner = NULL;
 }
 
-bool EffectColorWipe::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	color = intToRgbColor(json["color"]);
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
 
+/**********************      LedSegment      **********************/
+bool LedSegment::setView(uint16_t offset, uint16_t length, uint8_t flags) {	// Moves/resizes the segment (see LedFrame::setView). Fails if it has layers and its number of pixels would change (their buffers are sized for it)
+	const LedFrame view(&stripFrame, offset, length, flags);	// (Just to know how many pixels it'd have)
+	if (numLayers > 0 && view.PixelCount() != frame.PixelCount()) return false;
+
+	effects.setFrame(numLayers? baseFrame.get() : &frame);	// Ends any transition (its buffers were sized for the old view)
+	frame.setView(offset, length, flags);
 	return true;
 }
 
-bool EffectColorWipe::effectFunc() {
-	for (; i<N_PIXELS; ++i) {
-		if (didOneIter) return false;   // Already completed one iteration, return false (=not finished yet)
-
-		strip.SetPixelColor(i, color);
-		strip.Show();
-		didOneIter = true;
+LedLayer* LedSegment::addLayer(LedBlendMode blendMode, uint8_t alpha) {	// Adds a layer on top of the others (returns NULL if there's no room/heap). The first one moves effects to their own buffer, so they can be blended with it
+	if (numLayers >= LED_MAX_LAYERS) return NULL;
+	const uint16_t n = frame.PixelCount();
+
+	std::unique_ptr<LedLayer> layer(new (std::nothrow) LedLayer(n, blendMode, alpha));	// Everything is allocated before the segment is touched, so running out of heap leaves it as it was
+	if (!layer || !layer->buffer) return NULL;
+	if (numLayers == 0) {	// Effects can't keep drawing on frame: compose() overwrites it, and effects expect to find what they drew last time
+		std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[n*LedStripFeature::PixelSize]);
+		if (!buffer) return NULL;
+		std::unique_ptr<LedFrame> bufferFrame(new (std::nothrow) LedFrame(buffer.get(), n));
+		if (!bufferFrame) return NULL;
+		for (uint16_t i=0; i<n; ++i) {	// Start from what's currently shown so effects carry on seamlessly
+			LedStripFeature::applyPixelColor(buffer.get(), i, frame.GetPixelColor(i));
+		}
+		baseBuffer = std::move(buffer);
+		baseFrame = std::move(bufferFrame);
+		effects.setFrame(baseFrame.get());
 	}
 
-	return true;
+	layers[numLayers++] = layer.release();
+	baseFrame->markDirty(0, n);	// Recompose everything with the new layer
+	return layers[numLayers-1];
 }
 
+bool LedSegment::removeLayer(uint8_t n) {	// Deletes the n-th layer (0 = right above effects). Removing the last one makes effects draw straight on frame again
+	if (n >= numLayers) return false;
 
-/**********************      EffectRainbow      **********************/
-const char PROGMEM EffectRainbow::strCompressedEffectName[] = {"Rbow"};
-const char PROGMEM EffectRainbow::strReadableEffectName  [] = {"Rainbow"};
-const char PROGMEM EffectRainbow::strReadableEffectDesc  [] = {"Fills the entire strip with the colors of the rainbow and slowly rotates them around"};
-
-const uint16_t EffectRainbow::defaultTickInterval = 20;
-const uint8_t  EffectRainbow::defaultNumLoops = 1;
+	delete layers[n];
+	memmove(&layers[n], &layers[n+1], (numLayers-n-1)*sizeof(layers[0]));
+	--numLayers;
 
-bool EffectRainbow::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
+	if (numLayers == 0) {	// frame keeps the last composed image, effects carry on from there
+		effects.setFrame(&frame);
+		baseFrame.reset();
+		baseBuffer.reset();
+	} else {
+		baseFrame->markDirty(0, baseFrame->PixelCount());
+	}
+	return true;
+}
 
-	json["effectName"] = getCompressedEffectName();
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
+void LedSegment::loop() {	// Advances every layer's effects and composes the result into frame
+	effects.loop();
+	if (numLayers == 0) return;	// Effects drew straight on frame
 
-	return saveJSON(json, configPath);
+	for (uint8_t l=0; l<numLayers; ++l) {
+		layers[l]->effects.loop();
+	}
+	compose();
 }
 
-bool EffectRainbow::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
+void LedSegment::compose() {	// Blends baseFrame and every layer into frame, in a single pass over the pixels that changed in any of them
+	uint16_t start = baseFrame->getDirtyStart(), end = baseFrame->getDirtyEnd();
+	for (uint8_t l=0; l<numLayers; ++l) {
+		if (!layers[l]->frame.IsDirty()) continue;
+		start = min(start, layers[l]->frame.getDirtyStart());
+		end = max(end, layers[l]->frame.getDirtyEnd());
+	}
+	if (start >= end) return;	// Nothing changed
+
+	const uint8_t S = LedStripFeature::PixelSize;
+	for (uint16_t i=start; i<end; ++i) {
+		uint8_t px[S];
+		memcpy(px, baseBuffer.get() + i*S, S);
+		for (uint8_t l=0; l<numLayers; ++l) {	// Blending is per channel, so the byte order doesn't matter
+			const uint8_t* above = layers[l]->buffer.get() + i*S;
+			for (uint8_t c=0; c<S; ++c) {
+				px[c] = ledBlend(px[c], above[c], layers[l]->blendMode, layers[l]->alpha);
+			}
+		}
+		frame.SetPixelColor(i, LedStripFeature::retrievePixelColor(px, 0));
+	}
 
-	return true;
+	baseFrame->ResetDirty();
+	for (uint8_t l=0; l<numLayers; ++l) {
+		layers[l]->frame.ResetDirty();
+	}
 }
 
-bool EffectRainbow::effectFunc() {
-	for(; i<256; ++i) {
-		if (didOneIter) return false;   // Already completed one iteration, return false (=not finished yet)
 
-		for(uint16_t j=0; j<N_PIXELS; ++j) {
-			strip.SetPixelColor(j, Wheel((i+j) & 255));
-		}
-		strip.Show();
-		didOneIter = true;
+/**********************      EffectColorWipe      **********************/
+constexpr char EffectColorWipe::compressedName[];
+const char PROGMEM EffectColorWipe::strReadableEffectName[] = {"Color wipe"};
+const char PROGMEM EffectColorWipe::strReadableEffectDesc[] = {"Fills the strip with a specific color one led at a time from start to end"};
+const LedEffectParam EffectColorWipe::params[] = {
+	LED_EFFECT_PARAM(EffectColorWipe, color, LED_PARAM_COLOR),
+};
+const LedEffectInfo EffectColorWipe::info = {compressedName, strReadableEffectName, strReadableEffectDesc, params, sizeof(params)/sizeof(params[0]), &newLedEffect<EffectColorWipe>};
+
+const RgbColor EffectColorWipe::defaultColor = RgbColor(255, 0, 0);
+const uint16_t EffectColorWipe::defaultTickInterval = 20;
+const uint8_t  EffectColorWipe::defaultNumLoops = 1;
+
+bool EffectColorWipe::effectFunc(uint16_t ticks) {
+	for (; ticks>0; --ticks) {	// Every tick lights up one more pixel
+		if (i >= frame->PixelCount()) return true;	// (The full strip stays on for one tick before finishing)
+		frame->SetPixelColor(i++, color);
 	}
 
-	return true;
+	return false;
 }
 
 
-/**********************      EffectRainbowCycle      **********************/
-const char PROGMEM EffectRainbowCycle::strCompressedEffectName[] = {"RbowCyc"};
-const char PROGMEM EffectRainbowCycle::strReadableEffectName  [] = {"Rainbow cycle"};
-const char PROGMEM EffectRainbowCycle::strReadableEffectDesc  [] = {"Fills the entire strip with the colors of the rainbow and slowly rotates them around"};
+/**********************      EffectRainbow      **********************/
+constexpr char EffectRainbow::compressedName[];
+const char PROGMEM EffectRainbow::strReadableEffectName[] = {"Rainbow"};
+const char PROGMEM EffectRainbow::strReadableEffectDesc[] = {"Fills the entire strip with the colors of the rainbow and slowly rotates them around"};
+const LedEffectInfo EffectRainbow::info = {compressedName, strReadableEffectName, strReadableEffectDesc, NULL, 0, &newLedEffect<EffectRainbow>};
 
-const uint16_t EffectRainbowCycle::defaultTickInterval = 20;
-const uint8_t  EffectRainbowCycle::defaultNumLoops = 3;
+const uint16_t EffectRainbow::defaultTickInterval = 20;
+const uint8_t  EffectRainbow::defaultNumLoops = 1;
 
-bool EffectRainbowCycle::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
+bool EffectRainbow::effectFunc(uint16_t ticks) {
+	i += ticks-1;	// Skip straight to the last tick, only that one needs to be drawn
+	if (i >= 256) return true;
 
-	json["effectName"] = getCompressedEffectName();
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
+	paletteRainbow.fill(frame, i);	// Pixel j gets Wheel((i+j) & 255)
+	++i;
 
-	return saveJSON(json, configPath);
+	return false;
 }
 
-bool EffectRainbowCycle::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
 
-	return true;
-}
+/**********************      EffectRainbowCycle      **********************/
+constexpr char EffectRainbowCycle::compressedName[];
+const char PROGMEM EffectRainbowCycle::strReadableEffectName[] = {"Rainbow cycle"};
+const char PROGMEM EffectRainbowCycle::strReadableEffectDesc[] = {"Fills the entire strip with the colors of the rainbow and slowly rotates them around"};
+const LedEffectInfo EffectRainbowCycle::info = {compressedName, strReadableEffectName, strReadableEffectDesc, NULL, 0, &newLedEffect<EffectRainbowCycle>};
 
-bool EffectRainbowCycle::effectFunc() {
-	for(; i<256; i++) {
-		if (didOneIter) return false;   // Already completed one iteration, return false (=not finished yet)
+const uint16_t EffectRainbowCycle::defaultTickInterval = 20;
+const uint8_t  EffectRainbowCycle::defaultNumLoops = 3;
 
-		for(uint16_t j=0; j<N_PIXELS; ++j) {
-			strip.SetPixelColor(j, Wheel(((j * 256 / N_PIXELS) + i) & 255));
-		}
-		strip.Show();
-		didOneIter = true;
-	}
+bool EffectRainbowCycle::effectFunc(uint16_t ticks) {
+	i += ticks-1;	// Skip straight to the last tick, only that one needs to be drawn
+	if (i >= 256) return true;
 
-	return true;
+	const uint16_t n = frame->PixelCount();
+	if (n > 0) paletteRainbow.fill(frame, i, (256UL << 16) / n);	// The whole wheel spread over the strip, pixel j gets ~Wheel(j*256/n + i)
+	++i;
+
+	return false;
 }
 
 
 /**********************      EffectTheaterChase      **********************/
-const char PROGMEM EffectTheaterChase::strCompressedEffectName[] = {"Chase"};
-const char PROGMEM EffectTheaterChase::strReadableEffectName  [] = {"Theater chase"};
-const char PROGMEM EffectTheaterChase::strReadableEffectDesc  [] = {"Creates a set of 'particles' of a specific color which rotate around chasing each other"};
+constexpr char EffectTheaterChase::compressedName[];
+const char PROGMEM EffectTheaterChase::strReadableEffectName[] = {"Theater chase"};
+const char PROGMEM EffectTheaterChase::strReadableEffectDesc[] = {"Creates a set of 'particles' of a specific color which rotate around chasing each other"};
+const LedEffectParam EffectTheaterChase::params[] = {
+	LED_EFFECT_PARAM(EffectTheaterChase, color, LED_PARAM_COLOR),
+	LED_EFFECT_PARAM(EffectTheaterChase, step, LED_PARAM_U8),
+};
+const LedEffectInfo EffectTheaterChase::info = {compressedName, strReadableEffectName, strReadableEffectDesc, params, sizeof(params)/sizeof(params[0]), &newLedEffect<EffectTheaterChase>};
 
 const RgbColor EffectTheaterChase::defaultColor = RgbColor(255, 0, 0);
 const uint8_t  EffectTheaterChase::defaultStep = 5;
 const uint16_t EffectTheaterChase::defaultTickInterval = 50;
 const uint8_t  EffectTheaterChase::defaultNumLoops = 5;
 
-bool EffectTheaterChase::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
-
-	json["effectName"] = getCompressedEffectName();
-	json["color"] = rgbColorToInt(color);
-	json["step"] = step;
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
-
-	return saveJSON(json, configPath);
-}
-
-bool EffectTheaterChase::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	color = intToRgbColor(json["color"]);
-	step = json["step"];
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
-
-	return true;
-}
-
-bool EffectTheaterChase::effectFunc() {
-	for (; i<step; ++i) {
-		if (didOneIter) return false;   // Already completed one iteration, return false (=not finished yet)
-
-		for (uint16_t j=0; j<N_PIXELS; j+=step) {
-			strip.SetPixelColor(i+j, color);	// Turn on every other 'step' pixel
-		}
-		strip.Show();
-		didOneIter = true;
+bool EffectTheaterChase::effectFunc(uint16_t ticks) {
+	i += ticks-1;	// Skip straight to the last tick, only that one needs to be drawn
+	if (i >= step) return true;
 
-		for (uint16_t j=0; j<N_PIXELS; j+=step) {
-			strip.SetPixelColor(i+j, 0);	// Turn off every other 'step' pixel
-		}
+	for (uint16_t j=0, o=0; j<frame->PixelCount(); ++j, o=(o+1<step)? o+1:0) {	// o = j%step
+		frame->SetPixelColor(j, (o==i)? color : RgbColor(0));	// Turn on every other 'step' pixel (and off the ones from the previous iteration)
 	}
+	++i;
 
-	return true;
+	return false;
 }
 
 
 /**********************      EffectTheaterChaseRainbow      **********************/
-const char PROGMEM EffectTheaterChaseRainbow::strCompressedEffectName[] = {"ChaseRbow"};
-const char PROGMEM EffectTheaterChaseRainbow::strReadableEffectName  [] = {"Rainbow theater chase"};
-const char PROGMEM EffectTheaterChaseRainbow::strReadableEffectDesc  [] = {"Creates a set of 'particles' of the colors of the rainbow which rotate around chasing each other"};
+constexpr char EffectTheaterChaseRainbow::compressedName[];
+const char PROGMEM EffectTheaterChaseRainbow::strReadableEffectName[] = {"Rainbow theater chase"};
+const char PROGMEM EffectTheaterChaseRainbow::strReadableEffectDesc[] = {"Creates a set of 'particles' of the colors of the rainbow which rotate around chasing each other"};
+const LedEffectParam EffectTheaterChaseRainbow::params[] = {
+	LED_EFFECT_PARAM(EffectTheaterChaseRainbow, step, LED_PARAM_U8),
+};
+const LedEffectInfo EffectTheaterChaseRainbow::info = {compressedName, strReadableEffectName, strReadableEffectDesc, params, sizeof(params)/sizeof(params[0]), &newLedEffect<EffectTheaterChaseRainbow>};
 
 const uint8_t  EffectTheaterChaseRainbow::defaultStep = 5;
 const uint16_t EffectTheaterChaseRainbow::defaultTickInterval = 50;
 const uint8_t  EffectTheaterChaseRainbow::defaultNumLoops = 1;
 
-bool EffectTheaterChaseRainbow::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
-
-	json["effectName"] = getCompressedEffectName();
-	json["step"] = step;
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
-
-	return saveJSON(json, configPath);
-}
-
-bool EffectTheaterChaseRainbow::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	step = json["step"];
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
-
-	return true;
-}
-
-bool EffectTheaterChaseRainbow::effectFunc() {
-	for (; i<256; ++i) {     // cycle all 256 colors in the wheel
-		for (; j<step; ++j) {
-			if (didOneIter) return false;   // Already completed one iteration, return false (=not finished yet)
-
-			for (uint16_t k=0; k<N_PIXELS; k+=step) {
-				strip.SetPixelColor(k+j, Wheel((k+i) % 255));	// Turn on every other 'step' pixel
-			}
-			strip.Show();
-			didOneIter = true;
+bool EffectTheaterChaseRainbow::effectFunc(uint16_t ticks) {
+	uint32_t n = (uint32_t)i*step + j + ticks-1;	// Skip straight to the last tick (i cycles all 256 colors in the wheel, j goes through the step positions for each of them)
+	if (n >= 256*(uint32_t)step) return true;
+	i = n/step;
+	j = n%step;
 
-			for (uint16_t k=0; k<N_PIXELS; k+=step) {
-				strip.SetPixelColor(k+j, 0);	// Turn off every other 'step' pixel
-			}
-		}
+	for (uint16_t k=0, o=0; k<frame->PixelCount(); ++k, o=(o+1<step)? o+1:0) {	// o = k%step
+		frame->SetPixelColor(k, (o==j)? Wheel((k-j+i) % 255) : RgbColor(0));	// Turn on every other 'step' pixel (and off the ones from the previous iteration)
+	}
+	if (++j >= step) {
 		j = 0;
+		++i;
 	}
 
-	return true;
+	return false;
 }
 
 
 /**********************      EffectVolumeShifter      **********************/
-const char PROGMEM EffectVolumeShifter::strCompressedEffectName[] = {"VolShift"};
-const char PROGMEM EffectVolumeShifter::strReadableEffectName  [] = {"Volume shifter"};
-const char PROGMEM EffectVolumeShifter::strReadableEffectDesc  [] = {"Lights follow the volume of the music by changing color and intensity"};
+constexpr char EffectVolumeShifter::compressedName[];
+const char PROGMEM EffectVolumeShifter::strReadableEffectName[] = {"Volume shifter"};
+const char PROGMEM EffectVolumeShifter::strReadableEffectDesc[] = {"Lights follow the volume of the music by changing color, and flash on every onset"};
+const LedEffectParam EffectVolumeShifter::params[] = {
+	LED_EFFECT_PARAM(EffectVolumeShifter, tEffectLength, LED_PARAM_U32),
+};
+const LedEffectInfo EffectVolumeShifter::info = {compressedName, strReadableEffectName, strReadableEffectDesc, params, sizeof(params)/sizeof(params[0]), &newLedEffect<EffectVolumeShifter>};
 
 const uint32_t EffectVolumeShifter::defaultTeffectLength = 30000;
 const uint16_t EffectVolumeShifter::defaultTickInterval = -1;
 const uint8_t  EffectVolumeShifter::defaultNumLoops = 1;
 
-bool EffectVolumeShifter::saveConfigToFile(String configPath) {	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	StaticJsonBuffer<JSON_BUFFER_SIZE> jsonBuffer;
-	JsonObject& json = jsonBuffer.createObject();
-
-	json["effectName"] = getCompressedEffectName();
-	json["tEffectLength"] = tEffectLength;
-	json["tickInterval"] = tickInterval;
-	json["numLoops"] = numLoops;
-
-	return saveJSON(json, configPath);
-}
-
-bool EffectVolumeShifter::loadConfigFromJson(JsonObject& json) {	// Loads effect settings from JSON buffer (already parsed)
-	tEffectLength = json["tEffectLength"];
-	tickInterval = json["tickInterval"];
-	numLoops = json["numLoops"];
-
-	return true;
-}
-
-bool EffectVolumeShifter::effectFunc() {
+bool EffectVolumeShifter::effectFunc(uint16_t ticks) {
 	if (curr_time>=tDeadlineEffect && tEffectLength!=(uint32_t)-1)
 		return true;
 
-	strip.ShiftRight(1);
-	strip.SetPixelColor(0, HsbColor(0.6+0.4*curr_volume/(2*avg_volume), 1, (curr_volume > 1.5*avg_volume)?1:0.2));
-	strip.Show();
+	const AudioFrame& audio = getAudioFrame();
+	const float ratio = (audio.avgVolume > 0)? min(audio.volume/(2*audio.avgVolume), 2.0f) : 0;	// Hue goes from 0.6 (quiet) past red (1.0, twice as loud as usual) and wraps around
+	RgbColor c = hsvToRgb(153 + (uint8_t)(102*ratio), 255, audio.onset? 255:51);
+	frame->ShiftRight(ticks);	// Every tick shifts in one pixel of the current color
+	for (uint16_t k=0; k<ticks && k<frame->PixelCount(); ++k) {
+		frame->SetPixelColor(k, c);
+	}
 	return false;
 }
 
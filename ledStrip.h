@@ -3,18 +3,88 @@
 #define LED_STRIP_H_
 
 #include "main.h"						// HotTub global includes and definitions
-#include "FFT.h"						// FFT library so we can make effects that depend on current sound
+#include "audio.h"						// Audio analysis so we can make effects that depend on current sound
 #include "fileIO.h"						// File IO library contains SPIFFS filesystem and JSON parsers
 #include <NeoPixelBus.h>				// LED strip
+#include "neoNullMethod.h"				// Strip output that discards the frames (LED_STRIP_METHOD_NULL)
+#include "ledFrame.h"					// Frame buffer effects draw on
+#include "palette.h"					// Precomputed palettes and integer HSV
+#include "persistence.h"				// The effect list is saved in the background
 #include <vector>
+#include <memory>
+#include <new>							// std::nothrow (so running out of heap for a layer doesn't reset the board)
 
+#ifndef N_PIXELS			// (Can be overridden from the compiler's command line)
 #define N_PIXELS		450
-#define LED_PIN			3
+#endif
+#define LED_STRIP_METHOD_DMA		0	// I2S DMA: the frame is encoded into a DMA buffer and sent in the background (interrupts stay enabled). Always uses GPIO3 (RX)
+#define LED_STRIP_METHOD_ASYNC_UART	1	// UART1 fed from its interrupt, with its own copy of the frame, so Show returns right away. Always uses GPIO2 (TX1)
+#define LED_STRIP_METHOD_UART		2	// UART1, Show blocks until the frame fits in the FIFO (interrupts stay enabled). Always uses GPIO2 (TX1)
+#define LED_STRIP_METHOD_BITBANG	3	// Bit-bangs LED_PIN with interrupts disabled for the whole frame (~13.5ms for 450 pixels), so sample_isr misses samples. Only for debugging
+#define LED_STRIP_METHOD_NULL		4	// strip only keeps its framebuffer (see NeoNullMethod), eg: to profile the effects without the strip connected
+#ifndef LED_STRIP_METHOD			// (Can be overridden from the compiler's command line)
+#define LED_STRIP_METHOD			LED_STRIP_METHOD_DMA
+#endif
+#if LED_STRIP_METHOD == LED_STRIP_METHOD_UART || LED_STRIP_METHOD == LED_STRIP_METHOD_ASYNC_UART
+#define LED_PIN			2			// (Fixed by the hardware UART1)
+#else
+#define LED_PIN			3			// (Fixed by the hardware I2S if using DMA)
+#endif
+#define LED_EFFECT_MAX_TICKS	64		// Max number of iterations an effect is advanced in one frame. After a longer stall the effect skips ahead this much and resyncs with the clock, instead of catching up on every missed tick
+#define LED_MAX_SEGMENTS		4		// Max number of segments (including mainSegment)
+#define LED_SEGMENT_NAME_LEN	16
+#define LED_MAX_LAYERS			3		// Max number of layers blended on top of each segment's own effects
+#define LED_STRIP_FRAME_INTERVAL	10	// (ms) How often processLedStrip runs (pushing 450 pixels takes ~13.5ms anyway)
+#define LED_PLAYLIST_MAGIC			"LEDP"	// First bytes of a playlist file (see LedStripEffects::saveConfigToFile)
+#define LED_PLAYLIST_VERSION		1		// Bump it whenever the playlist format changes
+#define LED_PLAYLIST_MAX_NAME_LEN	31		// Max length of effect names and setting keys in a playlist
+#define LED_LAYOUT_FILE				"/ledEffects/segments.bin"	// Segment layout (with their layers) and every effect list but stripEffects (see writeLedLayout)
+#define LED_LAYOUT_MAGIC			"LEDS"	// First bytes of the layout file
+#define LED_LAYOUT_VERSION			2		// Bump it whenever the layout format changes
+#define LED_TRANSITION_DEFAULT_MS	500	// (ms) Default duration of the transition into each effect
+#define LED_GAMMA					2.2	// Gamma correction applied by the output stage (1 = none)
+#define LED_DEFAULT_BRIGHTNESS		255	// Global brightness (0-255) applied by the output stage on boot
+#define LED_DEFAULT_DITHER			true// Whether the output stage dithers (over time) the fraction lost when gamma+brightness round down to 8 bits
+#define LED_DEFAULT_POWER_BUDGET_MA	4000// (mA) Max current the strip may draw on boot (0 = no limit). Full white on all 450 pixels would be ~27A
+#define LED_MA_PER_CHANNEL			20	// (mA) Current drawn by each color channel of a pixel at 255 (WS2812B)
+#define LED_MA_IDLE					1	// (mA) Current drawn by each pixel even when it's off
+#define LED_CONFIG_SAVE_DELAY		2000	// (ms) stripEffects is saved once it's gone this long without changes (so dragging a slider doesn't write the flash on every step)...
+#define LED_CONFIG_SAVE_MAX_DELAY	10000	// (ms) ...or this long after the first unsaved change, whatever happens first (see addPersistTarget)
+
+enum LedTransitionType {	// How the effect list goes from one effect to the next (each effect sets the transition into itself)
+	LED_TRANSITION_CUT = 0,		// Straight to the new effect (which starts on a black strip)
+	LED_TRANSITION_CROSSFADE,	// Fade from the old effect's last frame to the new effect
+	LED_TRANSITION_WIPE,		// The new effect replaces the old one from the first pixel to the last
+	LED_TRANSITION_DISSOLVE,	// The new effect replaces the old one pixel by pixel, in pseudo-random order
+	N_LED_TRANSITIONS
+};
 
-extern NeoPixelBus<NeoGrbFeature, Neo800KbpsMethod> strip;
+#if LED_STRIP_METHOD == LED_STRIP_METHOD_DMA
+typedef NeoEsp8266Dma800KbpsMethod LedStripMethod;
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_ASYNC_UART
+typedef NeoEsp8266AsyncUart800KbpsMethod LedStripMethod;
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_UART
+typedef NeoEsp8266Uart800KbpsMethod LedStripMethod;
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_BITBANG
+typedef NeoEsp8266BitBang800KbpsMethod LedStripMethod;
+#else
+typedef NeoNullMethod LedStripMethod;
+#endif
+extern NeoPixelBus<LedStripFeature, LedStripMethod> strip;
+extern LedFrame stripFrame;
+extern uint32_t ledFramesRendered, ledFramesPushed, ledFramesDeferred;
+extern uint8_t ledBrightness;
+extern bool ledDither;
+extern uint16_t ledPowerBudget;
+extern uint16_t ledCurrentEstimate, ledCurrentLimited;	// (mA) What the last frame would draw without the power limiter, and after it
+extern uint32_t ledLimiterScale, ledFramesLimited;
 class LedStripEffect;
 class LedStripEffects;
-extern LedStripEffects stripEffects;
+class LedSegment;
+extern LedSegment mainSegment;
+extern LedStripEffects& stripEffects;	// mainSegment's effect list
+extern LedSegment* ledSegments[LED_MAX_SEGMENTS];
+extern uint8_t numLedSegments;
 
 
 /***************************************************/
@@ -28,67 +98,183 @@ void setupLedStrip();	// Initializes LED strip and the effect list stripEffects
 /***************************************************/
 uint32_t rgbColorToInt(RgbColor c);	// Converts an RgbColor to uint32_t so JSON can parse it
 RgbColor intToRgbColor(uint32_t c);	// Converts a uint32_t back to RgbColor
-void colorFull(RgbColor c);	// Fills the whole strip with given color
+void colorFull(RgbColor c);	// Fills the whole strip with given color (and shows it)
 RgbColor Wheel(byte WheelPos);	// Sort of HSV color generation (WheelPos is an approx. of a 0-255 hue value)
-void processLedStrip();	// "LEDstrip.loop()" function: executes an iteration of the current effect
+LedSegment* addLedSegment(const char* name, uint16_t offset, uint16_t length, uint8_t flags=0);	// Creates a segment covering pixels [offset, offset+length) of the strip (flags: LED_FRAME_REVERSE, LED_FRAME_MIRROR). Returns NULL if there's no room left or the name is taken
+LedSegment* getLedSegment(const char* name);	// Returns the segment called name (or NULL)
+bool removeLedSegment(const char* name);		// Deletes the segment called name (mainSegment can't be removed). Its pixels keep their last color until some other segment draws on them
+bool writeLedLayout(Stream& out);				// Writes the view and layers of every segment and every effect list but stripEffects to out (see loadLedLayout). Returns false if out couldn't take it all
+bool loadLedLayout(String path=LED_LAYOUT_FILE);	// Recreates the segments (and their layers) saved by writeLedLayout. If the file is missing or corrupt only mainSegment is left, covering the whole strip
+void setLedOutput(uint8_t brightness, bool dither);	// Sets the global brightness and dithering of the output stage (and rebuilds its LUT)
+void setLedPowerBudget(uint16_t mA);	// Sets the max current (mA) the strip may draw (0 = no limit)
+void applyOutputStage(uint16_t start, uint16_t end);	// Writes pixels [start, end) of stripFrame to strip's buffer through the gamma+brightness LUT, the power limiter and dithering
+void presentFrame();	// Pushes stripFrame to the strip through the output stage (at most one Show per call, and only if any pixel changed since the last one or the output stage needs another frame)
+void processLedStrip();	// "LEDstrip.loop()" function: executes an iteration of the current effect and presents the resulting frame
+String runLedControlCommand(char* json);	// Runs a control command (compact JSON, see webSocketControl) on an effect list right away and returns the reply (JSON)
 
 
 /***************************************************/
 /******           LED strip effects           ******/
 /***************************************************/
+/**********************      Effect registry      **********************/
+enum LedEffectParamType : uint8_t {LED_PARAM_U8=0, LED_PARAM_U16, LED_PARAM_U32, LED_PARAM_COLOR};	// Type of an effect setting (LED_PARAM_COLOR is an RgbColor, stored as uint32_t in JSON, see rgbColorToInt)
+
+struct LedEffectParam {	// One setting of an effect class, as it's stored in JSON
+	const char* key;
+	LedEffectParamType type;
+	void* (*field)(LedStripEffect* effect);	// Returns the address of the setting in effect
+};
+template<class E, typename T, T E::*member> void* ledEffectField(LedStripEffect* effect) { return &(static_cast<E*>(effect)->*member); }
+#define LED_EFFECT_PARAM_AS(key, Class, member, type)	{key, type, &ledEffectField<Class, decltype(Class::member), &Class::member>}
+#define LED_EFFECT_PARAM(Class, member, type)			LED_EFFECT_PARAM_AS(#member, Class, member, type)	// Setting stored as its member name
+
+struct LedEffectInfo {	// Everything the registry knows about an effect class (each class defines one, see LED_EFFECT_DECLARE)
+	const char* compressedName;	// Unique id of the class in config files
+	const char* readableName;	// (PROGMEM) To show in public settings
+	const char* readableDesc;	// (PROGMEM)
+	const LedEffectParam* params;	// Settings of the class, on top of LedStripEffect::baseParams
+	uint8_t numParams;
+	LedStripEffect* (*create)();	// Creates an instance with the default settings
+};
+template<class E> LedStripEffect* newLedEffect() { return new E(); }
+inline uint8_t ledEffectParamSize(LedEffectParamType type) { return (type == LED_PARAM_U8)? 1 : (type == LED_PARAM_U16)? 2 : 4; }	// Bytes a setting of that type takes in a playlist (colors are stored as rgbColorToInt)
+
+constexpr uint32_t fnv1a(const char* s, uint32_t hash=2166136261u) { return *s? fnv1a(s+1, (hash ^ (uint8_t)*s) * 16777619u) : hash; }	// FNV-1a hash of s (constexpr, so effect names can be switch cases)
+
+#define LED_EFFECT_DECLARE(compressed)	/* Declares the registry members of an effect class (define params, info, strReadableEffectName, strReadableEffectDesc and compressedName in the .cpp) */	\
+	static constexpr char compressedName[] = compressed;	\
+	static constexpr uint32_t nameHash = fnv1a(compressed);	\
+	static const char PROGMEM strReadableEffectName[], strReadableEffectDesc[];	\
+	static const LedEffectInfo info;	\
+	const LedEffectInfo& getInfo() const { return info; }
+
 /**********************      LedStripEffect      **********************/
 class LedStripEffect {	// Abstract class defining a general led strip effect (eg, turn all leds on to a specific color, rainbow effect, follow the music...)
 public:
-	LedStripEffect(uint16_t tickInterval=25, uint8_t numLoops=1) : tickInterval(tickInterval), numLoops((numLoops>254)? 254:numLoops) {}
+	LedStripEffect(uint16_t tickInterval=25, uint8_t numLoops=1) : tickInterval(tickInterval), numLoops((numLoops>254)? 254:numLoops), transitionType(LED_TRANSITION_CROSSFADE), transitionDuration(LED_TRANSITION_DEFAULT_MS), frame(&stripFrame) {}
+	virtual ~LedStripEffect() {}	// (Effects are deleted through LedStripEffect*)
 	
 	uint16_t tickInterval;	// "speed": interval in ms between iterations
 	uint8_t numLoops;		// Number of times to run the whole effect (in case the same effect wants to be played multiple times in a row). Defaults to 1
-
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	virtual String getCompressedEffectName() = 0;			// Returns "compressed" name of the effect (for saving/loading settings files)
-	virtual String getReadableEffectName() = 0;				// Returns human-readable name of the effect (to show in public settings)
-	virtual String getReadableEffectDesc() = 0;				// Returns human-readable description of the effect (to show in public settings)
-	virtual String toString() = 0;							// Returns a String description of the state of the effect (name, var values...) { return getReadableEffectName() + " (tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	static LedStripEffect* fromEffectName(String effectName);//(Dynamically) creates a new LedStripEffect of the right derived class based on effectName
+	uint8_t transitionType;			// LedTransitionType used when the effect list moves on to this effect
+	uint16_t transitionDuration;	// (ms) How long that transition lasts (0 = cut)
+	LedFrame* frame;		// Frame the effect draws on (effects never talk to the strip directly, processLedStrip presents the frame)
+
+	static const LedEffectParam baseParams[];	// Settings every effect has (tickInterval, numLoops and the transition into it)
+	static const uint8_t numBaseParams;
+	virtual const LedEffectInfo& getInfo() const = 0;		// Returns the registry entry of the effect's class (see LED_EFFECT_DECLARE)
+	String getCompressedEffectName() const { return getInfo().compressedName; }			// Returns "compressed" name of the effect (for saving/loading settings files)
+	String getReadableEffectName() const { return FPSTR(getInfo().readableName); }	// Returns human-readable name of the effect (to show in public settings)
+	String getReadableEffectDesc() const { return FPSTR(getInfo().readableDesc); }	// Returns human-readable description of the effect (to show in public settings)
+	String toString();										// Returns a String description of the state of the effect (name and the value of every setting)
+	uint8_t getNumParams() const { return numBaseParams + getInfo().numParams; }
+	const LedEffectParam& getParam(uint8_t n) const { return (n < numBaseParams)? baseParams[n] : getInfo().params[n - numBaseParams]; }	// n-th setting (base ones first)
+	int8_t findParam(const char* key) const;				// Index of the setting called key (-1 if there's none)
+	uint32_t getParamValue(uint8_t n);						// Value of the n-th setting (colors as rgbColorToInt)
+	void setParamValue(uint8_t n, uint32_t value);			// Sets the n-th setting (colors as rgbColorToInt)
+
+	static LedStripEffect* fromEffectName(const char* effectName);	// (Dynamically) creates a new LedStripEffect of the right derived class based on effectName (NULL if unknown)
 	static LedStripEffect* fromJson(String configPath);		// (Dynamically) creates and configures a new LedStripEffect of the right derived class based on the contents of the supplied JSON configuration file
-	virtual bool loadConfigFromJson(JsonObject& json) = 0;	// Loads effect settings from JSON buffer (already parsed)
-	virtual bool saveConfigToFile(String configPath) = 0;	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
+	bool loadConfigFromJson(JsonObject& json);				// Loads every setting in the effect's schema found in json (missing ones keep their current value)
+	void saveConfigToJson(JsonObject& json);				// Stores the effect name and every setting in its schema in json
+	bool saveConfigToFile(String configPath);				// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
 	
-	virtual bool effectFunc() = 0;							// Controls the led strip in whichever way the effect wants. Returns false at the end of every iteration but the last one (true)
+	virtual bool effectFunc(uint16_t ticks) = 0;			// Advances the effect by ticks iterations and draws only the resulting state on frame. Returns true once the effect is over (remaining ticks are dropped), false otherwise
 	virtual void resetCounters() = 0;						// Resets any counters/variables so that the effect starts back at the first iteration
 	
 	void preEffectReset(bool resetCntLoops=true);			// Resets all effect related variables before executing the first iteration of the effect
-	bool loop();	// Runs as many iterations of the effect as needed based on current time and then returns whether the effect is done (true) or not (false)
+	bool step(uint16_t ticks=1) { return effectFunc(ticks); }	// Advances the effect by ticks iterations (regardless of the time) and returns whether it's over
+	bool loop();	// Advances the effect to the current time (drawing only the latest state) and then returns whether the effect is done (true) or not (false)
 
 protected:
 	uint32_t tNextIteration;// Time (ms) after which a new iteration of the effect will be exectued
-	bool didOneIter;		// Auxiliary variable that effectFunc() will use to exit right after performing one iteration
 	uint8_t cntLoops;		// Counter to keep track of how many times the whole effect has been executed in a row
 };
 
 /**********************      LedStripEffects      **********************/
 class LedStripEffects {
 public:
-	LedStripEffects() : currEffect(0) {}
+	LedStripEffects(LedFrame* frame=&stripFrame) : currEffect(0), frame(frame) {}
+	~LedStripEffects() { clear(); }	// (The list owns its effects)
 
 	static const String configFolder;		// Indicates the path to the folder where all the effect-related config files is stored in the SPIFFS
-	static const String configFile;			// Indicates the path to the SPIFFS file where we store how many effects we stored in 'configFolder'
-	static const String configFilePrefix;	// Indicates the prefix for the SPIFFS files containing config settings for each individual effect
+	static const String configFile;			// Whole effect list in one versioned, checksummed binary file (see saveConfigToFile)
+	static const String legacyConfigFile;	// Old layout: how many effects we stored in 'configFolder' (only read to migrate to configFile)
+	static const String configFilePrefix;	// Old layout: prefix for the SPIFFS files containing config settings for each individual effect
 
 	void loadDefaultEffectList();							// Loads the default effect list (useful for example if loading the config from file failed)
-	bool loadConfigFromFile(String configPath=configFile);	// Loads effect list from SPIFFS JSON file located at configPath
-	bool saveConfigToFile(String configPath=configFile);	// Stores current list of effects and their configuration to a SPIFFS JSON file (so settings can be loaded on reboot)
+	bool loadConfigFromFile(String configPath=configFile);	// Loads the effect list from the playlist at configPath (migrating the old layout if there's no playlist yet). Falls back to the default list if neither works
+	bool saveConfigToFile(String configPath=configFile);	// Stores the effect list as a playlist at configPath (written to a temp file first and then renamed, so a crash never leaves a half-written playlist)
+	bool writePlaylist(Stream& f);							// Writes the effect list to f in the playlist format (see saveConfigToFile). Returns false if f couldn't take it all
+	bool readPlaylist(Stream& f, const String& path);		// Loads the effect list from f in the playlist format (path is only for the console). The current list is only replaced if the whole playlist is valid (right magic, version and checksum)
 	void restartEffectList();
 	void nextEffect();
-	void addEffect(LedStripEffect* effect);
-	void removeEffect(uint8_t n, bool restart=true);
+	void playEffect(uint8_t n);				// Jumps to the n-th effect (through the transition into it)
+	void addEffect(LedStripEffect* effect);	// Takes ownership of effect and makes it draw on this list's frame
+	void insertEffect(LedStripEffect* effect, uint8_t n);	// Takes ownership of effect and inserts it at position n (at the end if n is past it) without interrupting the current effect
+	bool moveEffect(uint8_t from, uint8_t to);	// Moves the from-th effect to position to without interrupting the current effect
+	void setFrame(LedFrame* frame);			// Makes every effect in the list (and the ones added later) draw on frame
+	void removeEffect(uint8_t n, bool restart=true);	// Deletes the n-th effect. If !restart, the list goes on where it was (with the next effect if n was the current one)
 	void clear();
 	void loop();
+	bool isTransitioning() const { return transitionOwner == this; }
+	uint8_t getNumEffects() const { return listEffects.size(); }
+	LedStripEffect* getEffect(uint8_t n) const { return (n < listEffects.size())? listEffects[n] : NULL; }
+	uint8_t getCurrEffect() const { return currEffect; }
 
 protected:
 	std::vector<LedStripEffect*> listEffects;
 	uint8_t currEffect;	// Counter to keep track of how many times the whole effect has been executed in a row (useful if we want to repeat the same effect multiple times)
+	LedFrame* frame;	// Frame (or segment) every effect in the list draws on
+	uint32_t tTransitionStart;
+
+	bool loadPlaylist(String path);	// Loads the effect list from the playlist at path. The current list is only replaced if the whole file is valid (right magic, version and checksum)
+	bool loadLegacyConfig(uint8_t& failures);	// Loads the effect list from the old layout (legacyConfigFile + one JSON file per effect). failures is set to the number of effect files that couldn't be loaded (they're left out of the list)
+
+	static uint8_t transitionPixels[2][N_PIXELS*LedStripFeature::PixelSize];	// Only one list can be transitioning at a time (the others just cut), so the memory needed is fixed: the old effect's last frame and the new effect's frame
+	static LedFrame transitionFrom, transitionTo;
+	static LedStripEffects* transitionOwner;	// List currently using the buffers above (NULL if none)
+	void beginTransition(LedStripEffect* effect);	// Freezes what's on frame and makes effect draw on transitionTo
+	void composeTransition();	// Draws the blend of transitionFrom and transitionTo on frame (and ends the transition once it's over)
+	void endTransition();		// Copies transitionTo to frame and makes the new effect draw on frame again
+};
+
+/**********************      LedLayer      **********************/
+class LedLayer {	// Effect list that renders into its own buffer, which is then blended on top of what's below it (see LedSegment::compose)
+public:
+	LedLayer(uint16_t count, LedBlendMode blendMode, uint8_t alpha) : buffer(new (std::nothrow) uint8_t[count*LedStripFeature::PixelSize]()), frame(buffer.get(), count), effects(&frame), blendMode(blendMode), alpha(alpha) {}
+
+	std::unique_ptr<uint8_t[]> buffer;	// 3 bytes per pixel, in the strip's byte order (NULL if there wasn't enough heap)
+	LedFrame frame;
+	LedStripEffects effects;
+	LedBlendMode blendMode;
+	uint8_t alpha;						// How much of the layer shows (0-255)
+};
+
+/**********************      LedSegment      **********************/
+class LedSegment {	// Named range of the strip (optionally reversed and/or mirrored) that runs its own effect list, plus optional layers blended on top. All segments draw on stripFrame in order (so later ones win where they overlap) and the strip is shown once per frame
+public:
+	LedSegment(const char* name, uint16_t offset, uint16_t length, uint8_t flags=0) : frame(&stripFrame, offset, length, flags), effects(&frame), numLayers(0) { strlcpy(this->name, name, sizeof(this->name)); }
+	~LedSegment() { while (numLayers > 0) removeLayer(numLayers-1); }
+
+	char name[LED_SEGMENT_NAME_LEN];
+	LedFrame frame;				// View of stripFrame the segment draws on
+	LedStripEffects effects;	// Bottom layer: draws straight on frame if there are no layers, otherwise on baseFrame
+
+	bool setView(uint16_t offset, uint16_t length, uint8_t flags=0);	// Moves/resizes the segment (see LedFrame::setView). Fails if it has layers and its number of pixels would change (their buffers are sized for it)
+	LedLayer* addLayer(LedBlendMode blendMode, uint8_t alpha=255);	// Adds a layer on top of the others (returns NULL if there's no room/heap). The first one moves effects to their own buffer, so they can be blended with it
+	bool removeLayer(uint8_t n);			// Deletes the n-th layer (0 = right above effects). Removing the last one makes effects draw straight on frame again
+	LedLayer* getLayer(uint8_t n) const { return (n < numLayers)? layers[n] : NULL; }
+	uint8_t getNumLayers() const { return numLayers; }
+	void loop();							// Advances every layer's effects and composes the result into frame
+
+protected:
+	LedLayer* layers[LED_MAX_LAYERS];
+	uint8_t numLayers;
+	std::unique_ptr<uint8_t[]> baseBuffer;	// Where effects draw when there are layers
+	std::unique_ptr<LedFrame> baseFrame;
+
+	void compose();	// Blends baseFrame and every layer into frame, in a single pass over the pixels that changed in any of them
 };
 
 /**********************      EffectColorWipe      **********************/
@@ -102,17 +288,11 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectColorWipe::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectColorWipe::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectColorWipe::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (c:[" + color.R + "," + color.G + "," + color.B + "]; tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("ClrWipe");
+	static const LedEffectParam params[];
 	
 	void resetCounters() { i = 0; }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint16_t i;
@@ -127,17 +307,10 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectRainbow::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectRainbow::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectRainbow::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("Rbow");
 	
 	void resetCounters() { i = 0; }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint16_t i;
@@ -152,17 +325,10 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 	
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectRainbowCycle::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectRainbowCycle::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectRainbowCycle::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("RbowCyc");
 	
 	void resetCounters() { i = 0; }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint16_t i;
@@ -181,17 +347,11 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectTheaterChase::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectTheaterChase::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectTheaterChase::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (c:[" + color.R + "," + color.G + "," + color.B + "]; step:" + step + "; tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("Chase");
+	static const LedEffectParam params[];
 	
 	void resetCounters() { i = 0; }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint16_t i;
@@ -208,17 +368,11 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectTheaterChaseRainbow::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectTheaterChaseRainbow::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectTheaterChaseRainbow::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (step:" + step + "; tick:" + tickInterval + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("ChaseRbow");
+	static const LedEffectParam params[];
 	
 	void resetCounters() { i = j = 0; }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint16_t i, j;
@@ -234,17 +388,11 @@ public:
 	static const uint16_t defaultTickInterval;
 	static const uint8_t  defaultNumLoops;
 
-	static const char PROGMEM strCompressedEffectName[], strReadableEffectName[], strReadableEffectDesc[];	// Static constants to hold the unique string that getCompressedEffectName, etc. return
-	String getCompressedEffectName() { return FPSTR(EffectVolumeShifter::strCompressedEffectName); }
-	String getReadableEffectName()   { return FPSTR(EffectVolumeShifter::strReadableEffectName); }
-	String getReadableEffectDesc()   { return FPSTR(EffectVolumeShifter::strReadableEffectDesc); }
-	String toString() { return getReadableEffectName() + " (length:" + tEffectLength + "ms; loops:" + numLoops + ")"; }
-
-	bool saveConfigToFile(String configPath);	// Stores current values of all variables related to the effect (so settings can be loaded on reboot)
-	bool loadConfigFromJson(JsonObject& json);	// Loads effect settings from JSON buffer (already parsed)
+	LED_EFFECT_DECLARE("VolShift");
+	static const LedEffectParam params[];
 	
 	void resetCounters() { tDeadlineEffect = curr_time + tEffectLength; consolePrintf("%s set deadline for t=%lums\n", getReadableEffectName().c_str(), tDeadlineEffect); }
-	bool effectFunc();
+	bool effectFunc(uint16_t ticks);
 
 protected:
 	uint32_t tEffectLength, tDeadlineEffect;
@@ -0,0 +1,34 @@
+/******      Null NeoPixelBus method      ******/
+#ifndef NEO_NULL_METHOD_H_
+#define NEO_NULL_METHOD_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**********************      NeoNullMethod      **********************/
+class NeoNullMethod {	// NeoPixelBus method that doesn't drive any pin: pixels just stay in the framebuffer (so effects can be run/profiled without the strip, or without the cost of sending the data out)
+public:
+	static uint32_t updateCount;	// Number of times Show() actually pushed a frame (would have been sent to the strip)
+
+	NeoNullMethod(uint8_t pin, uint16_t pixelCount, size_t elementSize) : NeoNullMethod(pixelCount, elementSize) {}
+	NeoNullMethod(uint16_t pixelCount, size_t elementSize) : _sizePixels(pixelCount * elementSize) {
+		_pixels = (uint8_t*)malloc(_sizePixels);
+		memset(_pixels, 0, _sizePixels);
+	}
+	~NeoNullMethod() { free(_pixels); }
+
+	bool IsReadyToUpdate() const { return true; }
+	void Initialize() {}
+	void Update() { ++updateCount; }
+	void Update(bool maintainBufferConsistency) { Update(); }	// Newer NeoPixelBus versions pass this argument
+	uint8_t* getPixels() const { return _pixels; }
+	size_t getPixelsSize() const { return _sizePixels; }
+
+private:
+	const size_t _sizePixels;
+	uint8_t* _pixels;
+};
+
+#endif
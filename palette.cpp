@@ -0,0 +1,70 @@
+/******      LED palettes      ******/
+#include "palette.h"
+
+const uint8_t PROGMEM paletteRainbowRGB[PALETTE_SIZE*3] = {	// Wheel(i) for every i (R, G, B)
+	255,  0,  0, 252,  3,  0, 249,  6,  0, 246,  9,  0, 243, 12,  0, 240, 15,  0, 237, 18,  0, 234, 21,  0,
+	231, 24,  0, 228, 27,  0, 225, 30,  0, 222, 33,  0, 219, 36,  0, 216, 39,  0, 213, 42,  0, 210, 45,  0,
+	207, 48,  0, 204, 51,  0, 201, 54,  0, 198, 57,  0, 195, 60,  0, 192, 63,  0, 189, 66,  0, 186, 69,  0,
+	183, 72,  0, 180, 75,  0, 177, 78,  0, 174, 81,  0, 171, 84,  0, 168, 87,  0, 165, 90,  0, 162, 93,  0,
+	159, 96,  0, 156, 99,  0, 153,102,  0, 150,105,  0, 147,108,  0, 144,111,  0, 141,114,  0, 138,117,  0,
+	135,120,  0, 132,123,  0, 129,126,  0, 126,129,  0, 123,132,  0, 120,135,  0, 117,138,  0, 114,141,  0,
+	111,144,  0, 108,147,  0, 105,150,  0, 102,153,  0,  99,156,  0,  96,159,  0,  93,162,  0,  90,165,  0,
+	 87,168,  0,  84,171,  0,  81,174,  0,  78,177,  0,  75,180,  0,  72,183,  0,  69,186,  0,  66,189,  0,
+	 63,192,  0,  60,195,  0,  57,198,  0,  54,201,  0,  51,204,  0,  48,207,  0,  45,210,  0,  42,213,  0,
+	 39,216,  0,  36,219,  0,  33,222,  0,  30,225,  0,  27,228,  0,  24,231,  0,  21,234,  0,  18,237,  0,
+	 15,240,  0,  12,243,  0,   9,246,  0,   6,249,  0,   3,252,  0,   0,255,  0,   0,252,  3,   0,249,  6,
+	  0,246,  9,   0,243, 12,   0,240, 15,   0,237, 18,   0,234, 21,   0,231, 24,   0,228, 27,   0,225, 30,
+	  0,222, 33,   0,219, 36,   0,216, 39,   0,213, 42,   0,210, 45,   0,207, 48,   0,204, 51,   0,201, 54,
+	  0,198, 57,   0,195, 60,   0,192, 63,   0,189, 66,   0,186, 69,   0,183, 72,   0,180, 75,   0,177, 78,
+	  0,174, 81,   0,171, 84,   0,168, 87,   0,165, 90,   0,162, 93,   0,159, 96,   0,156, 99,   0,153,102,
+	  0,150,105,   0,147,108,   0,144,111,   0,141,114,   0,138,117,   0,135,120,   0,132,123,   0,129,126,
+	  0,126,129,   0,123,132,   0,120,135,   0,117,138,   0,114,141,   0,111,144,   0,108,147,   0,105,150,
+	  0,102,153,   0, 99,156,   0, 96,159,   0, 93,162,   0, 90,165,   0, 87,168,   0, 84,171,   0, 81,174,
+	  0, 78,177,   0, 75,180,   0, 72,183,   0, 69,186,   0, 66,189,   0, 63,192,   0, 60,195,   0, 57,198,
+	  0, 54,201,   0, 51,204,   0, 48,207,   0, 45,210,   0, 42,213,   0, 39,216,   0, 36,219,   0, 33,222,
+	  0, 30,225,   0, 27,228,   0, 24,231,   0, 21,234,   0, 18,237,   0, 15,240,   0, 12,243,   0,  9,246,
+	  0,  6,249,   0,  3,252,   0,  0,255,   3,  0,252,   6,  0,249,   9,  0,246,  12,  0,243,  15,  0,240,
+	 18,  0,237,  21,  0,234,  24,  0,231,  27,  0,228,  30,  0,225,  33,  0,222,  36,  0,219,  39,  0,216,
+	 42,  0,213,  45,  0,210,  48,  0,207,  51,  0,204,  54,  0,201,  57,  0,198,  60,  0,195,  63,  0,192,
+	 66,  0,189,  69,  0,186,  72,  0,183,  75,  0,180,  78,  0,177,  81,  0,174,  84,  0,171,  87,  0,168,
+	 90,  0,165,  93,  0,162,  96,  0,159,  99,  0,156, 102,  0,153, 105,  0,150, 108,  0,147, 111,  0,144,
+	114,  0,141, 117,  0,138, 120,  0,135, 123,  0,132, 126,  0,129, 129,  0,126, 132,  0,123, 135,  0,120,
+	138,  0,117, 141,  0,114, 144,  0,111, 147,  0,108, 150,  0,105, 153,  0,102, 156,  0, 99, 159,  0, 96,
+	162,  0, 93, 165,  0, 90, 168,  0, 87, 171,  0, 84, 174,  0, 81, 177,  0, 78, 180,  0, 75, 183,  0, 72,
+	186,  0, 69, 189,  0, 66, 192,  0, 63, 195,  0, 60, 198,  0, 57, 201,  0, 54, 204,  0, 51, 207,  0, 48,
+	210,  0, 45, 213,  0, 42, 216,  0, 39, 219,  0, 36, 222,  0, 33, 225,  0, 30, 228,  0, 27, 231,  0, 24,
+	234,  0, 21, 237,  0, 18, 240,  0, 15, 243,  0, 12, 246,  0,  9, 249,  0,  6, 252,  0,  3, 255,  0,  0,
+};
+const LedPalette paletteRainbow(paletteRainbowRGB);
+
+
+/**********************      LedPalette      **********************/
+void LedPalette::fill(LedFrame* frame, uint8_t startIndex, uint32_t indexStep) const {	// Sets pixel j of frame to get(startIndex + j*indexStep), where indexStep is 16.16 fixed point (default: one entry per pixel)
+	uint32_t index = (uint32_t)startIndex << 16;
+	for (uint16_t j=0; j<frame->PixelCount(); ++j) {
+		frame->SetPixelColor(j, get(index >> 16));	// (Only the lower 8 bits of the index matter, so it wraps around)
+		index += indexStep;
+	}
+}
+
+
+/***************************************************/
+/******        Color related functions        ******/
+/***************************************************/
+RgbColor hsvToRgb(uint8_t h, uint8_t s, uint8_t v) {	// Integer-only HSV to RGB (h, s and v are 0-255, h=256 would be back to red)
+	if (s == 0) return RgbColor(v);
+
+	const uint8_t sector = h / 43;				// 6 sectors of ~43 hue steps
+	const uint8_t frac = (h - sector*43) * 6;	// Position within the sector (0-252)
+	const uint8_t p = (v * (255 - s)) >> 8;
+	const uint8_t q = (v * (255 - ((s * frac) >> 8))) >> 8;
+	const uint8_t t = (v * (255 - ((s * (255 - frac)) >> 8))) >> 8;
+	switch (sector) {
+		case 0:  return RgbColor(v, t, p);
+		case 1:  return RgbColor(q, v, p);
+		case 2:  return RgbColor(p, v, t);
+		case 3:  return RgbColor(p, q, v);
+		case 4:  return RgbColor(t, p, v);
+		default: return RgbColor(v, p, q);
+	}
+}
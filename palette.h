@@ -0,0 +1,36 @@
+/******      LED palettes      ******/
+#ifndef PALETTE_H_
+#define PALETTE_H_
+
+#include "main.h"						// Global includes and definitions
+#include "ledFrame.h"					// Frame buffer effects draw on
+
+#define PALETTE_SIZE	256				// Entries per palette (so any uint8_t is a valid index)
+
+extern const uint8_t PROGMEM paletteRainbowRGB[PALETTE_SIZE*3];	// The classic Wheel: red -> green -> blue -> red, full saturation and brightness
+
+
+/**********************      LedPalette      **********************/
+class LedPalette {	// PALETTE_SIZE colors effects pick by index (hue, position, volume...), so drawing a pixel is a table lookup instead of color math
+public:
+	LedPalette(const uint8_t* progmemEntries) : entries(progmemEntries) {}	// Wraps a PROGMEM table of PALETTE_SIZE RGB triplets
+
+	RgbColor get(uint8_t i) const {	// Returns the i-th color
+		const uint8_t* e = entries + 3*i;
+		return RgbColor(pgm_read_byte(e), pgm_read_byte(e+1), pgm_read_byte(e+2));
+	}
+	void fill(LedFrame* frame, uint8_t startIndex, uint32_t indexStep=0x10000) const;	// Sets pixel j of frame to get(startIndex + j*indexStep), where indexStep is 16.16 fixed point (default: one entry per pixel)
+
+protected:
+	const uint8_t* entries;	// (PROGMEM)
+};
+
+extern const LedPalette paletteRainbow;
+
+
+/***************************************************/
+/******        Color related functions        ******/
+/***************************************************/
+RgbColor hsvToRgb(uint8_t h, uint8_t s, uint8_t v);	// Integer-only HSV to RGB (h, s and v are 0-255, h=256 would be back to red)
+
+#endif
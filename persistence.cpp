@@ -0,0 +1,303 @@
+/******      Background persistence      ******/
+#include "persistence.h"
+
+PersistTarget persistTargets[PERSIST_MAX_TARGETS];
+uint8_t numPersistTargets = 0;
+PersistBuffer persistBuffer;	// Snapshot of the target being written
+int8_t persistFlushing = -1;	// Target being written to its temp file (-1 if none)
+File persistFile;
+size_t persistFilePos;			// (B) How much of persistBuffer is already in persistFile
+
+struct PersistJournalEntry {	// What the journal knows about a target (even if it's not registered in this firmware)
+	uint32_t nameHash;
+	uint32_t writes;
+};
+PersistJournalEntry persistJournal[PERSIST_JOURNAL_MAX_ENTRIES];
+uint8_t numPersistJournalEntries = 0;
+
+/* Journal format: a sequence of records (little endian), appended as they happen
+ *	'B', nameHash (uint32_t), size (uint32_t), CRC-32 (uint32_t), path length (uint8_t), path	A temp file was completely written and is about to replace path
+ *	'D', nameHash (uint32_t), writes (uint32_t)											It did (or, after compacting, just the wear counter)
+ * A 'B' without a 'D' after it is a commit interrupted by a reset: setupPersistence finishes it if the temp file is still intact
+ */
+#define PERSIST_RECORD_BEGIN	'B'
+#define PERSIST_RECORD_DONE		'D'
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+PersistJournalEntry* getPersistJournalEntry(uint32_t nameHash) {	// Returns the journal entry of nameHash, adding it if there's none (NULL if there's no room left)
+	for (uint8_t i=0; i<numPersistJournalEntries; ++i) {
+		if (persistJournal[i].nameHash == nameHash) return &persistJournal[i];
+	}
+	if (numPersistJournalEntries >= PERSIST_JOURNAL_MAX_ENTRIES) return NULL;
+	PersistJournalEntry* entry = &persistJournal[numPersistJournalEntries++];
+	entry->nameHash = nameHash;
+	entry->writes = 0;
+	return entry;
+}
+
+uint32_t fileCrc32(File& f) {	// CRC-32 of the rest of f
+	uint8_t buf[64];
+	uint32_t crc = 0;
+	size_t len;
+	while ((len = f.read(buf, sizeof(buf))) > 0) {
+		crc = crc32Update(crc, buf, len);
+	}
+	return crc;
+}
+
+void compactPersistJournal() {	// Rewrites the journal as just one wear counter per target
+	for (uint8_t i=0; i<numPersistTargets; ++i) {
+		PersistJournalEntry* entry = getPersistJournalEntry(persistTargets[i].nameHash);
+		if (entry) entry->writes = persistTargets[i].writes;
+	}
+
+	const String tmpPath = SF(PERSIST_JOURNAL_FILE) + FILE_TMP_SUFFIX;
+	File f = SPIFFS.open(tmpPath, "w");
+	if (!f) {
+		consolePrintF("Couldn't compact the persistence journal :(\n");
+		return;
+	}
+	bool ok = true;
+	for (uint8_t i=0; i<numPersistJournalEntries; ++i) {
+		ok = ok && f.write((uint8_t)PERSIST_RECORD_DONE) && f.write((const uint8_t*)&persistJournal[i].nameHash, 4) == 4 && f.write((const uint8_t*)&persistJournal[i].writes, 4) == 4;
+	}
+	f.close();
+	if (!ok || !replaceFile(tmpPath, PERSIST_JOURNAL_FILE)) {
+		consolePrintF("Couldn't compact the persistence journal :(\n");
+		SPIFFS.remove(tmpPath);
+	}
+}
+
+void setupPersistence() {	// Replays the journal (finishing commits interrupted by a reset, discarding half-written files and loading the wear counters) and compacts it. Call it after setupFileIO and before loading any target
+	struct {	// Last commit of every journal entry that was begun but not done
+		bool pending;
+		uint32_t size, crc;
+		char path[32];
+	} commits[PERSIST_JOURNAL_MAX_ENTRIES] = {};
+
+	recoverFile(PERSIST_JOURNAL_FILE);	// In case power was lost while compacting it
+	File f = SPIFFS.open(PERSIST_JOURNAL_FILE, "r");
+	while (f && f.available()) {
+		uint8_t type = f.read();
+		uint32_t nameHash, a, b;
+		uint8_t len = 0;
+		char path[sizeof(commits[0].path)];
+		if (type == PERSIST_RECORD_BEGIN) {
+			if (f.read((uint8_t*)&nameHash, 4) != 4 || f.read((uint8_t*)&a, 4) != 4 || f.read((uint8_t*)&b, 4) != 4 || f.read(&len, 1) != 1 || len >= sizeof(path) || f.read((uint8_t*)path, len) != len) break;	// (A record cut short by a reset is the end of the journal)
+			path[len] = '\0';
+		} else if (type == PERSIST_RECORD_DONE) {
+			if (f.read((uint8_t*)&nameHash, 4) != 4 || f.read((uint8_t*)&a, 4) != 4) break;
+		} else {
+			break;
+		}
+
+		PersistJournalEntry* entry = getPersistJournalEntry(nameHash);
+		if (!entry) continue;
+		uint8_t i = entry - persistJournal;
+		commits[i].pending = (type == PERSIST_RECORD_BEGIN);
+		if (type == PERSIST_RECORD_BEGIN) {
+			commits[i].size = a;
+			commits[i].crc = b;
+			strcpy(commits[i].path, path);
+		} else {
+			entry->writes = a;
+		}
+	}
+	if (f) f.close();
+
+	for (uint8_t i=0; i<numPersistJournalEntries; ++i) {
+		if (!commits[i].pending) continue;
+		const String tmpPath = String(commits[i].path) + FILE_TMP_SUFFIX;
+		File tmp = SPIFFS.open(tmpPath, "r");
+		const bool hasTmp = tmp;
+		const bool intact = hasTmp && tmp.size() == commits[i].size && fileCrc32(tmp) == commits[i].crc;
+		if (hasTmp) tmp.close();
+		if (intact) {
+			if (replaceFile(tmpPath, commits[i].path)) {
+				consolePrintF("Finished writing %s (interrupted by a reset)\n", commits[i].path);
+				++persistJournal[i].writes;
+			}
+		} else if (!hasTmp) {	// Either it was renamed but the reset came before the 'D' record, or the new contents are lost
+			File done = SPIFFS.open(commits[i].path, "r");
+			if (done && done.size() == commits[i].size && fileCrc32(done) == commits[i].crc) ++persistJournal[i].writes;
+			if (done) done.close();
+		} else {
+			SPIFFS.remove(tmpPath);	// Corrupted: keep the old contents
+		}
+	}
+	compactPersistJournal();
+	consolePrintF("Persistence journal loaded (%d targets)\n", numPersistJournalEntries);
+}
+
+
+/*****************************************************/
+/******      Persistence related functions      ******/
+/*****************************************************/
+int8_t addPersistTarget(const char* name, const char* path, PersistSerializeFunc serialize, PersistWriteFunc write, uint16_t delay, uint16_t maxDelay) {	// Registers a target (path+serialize for SPIFFS files, NULL+NULL+write otherwise) and returns its id (-1 if there's no room left)
+	if (numPersistTargets >= PERSIST_MAX_TARGETS) {
+		consolePrintF("Can't add persistence target %s, all %d slots are taken :(\n", name, PERSIST_MAX_TARGETS);
+		return -1;
+	}
+
+	PersistTarget& target = persistTargets[numPersistTargets];
+	target.name = name;
+	target.path = path;
+	target.serialize = serialize;
+	target.write = write;
+	target.delay = delay;
+	target.maxDelay = maxDelay;
+	target.nameHash = crc32Update(0, name, strlen(name));
+	target.dirty = false;
+	target.tRetry = curr_time;
+	target.changes = target.writesSinceBoot = target.failures = 0;
+	PersistJournalEntry* entry = getPersistJournalEntry(target.nameHash);
+	target.writes = entry? entry->writes : 0;
+
+	if (path) {	// A temp file next to path that setupPersistence didn't commit was never completely written (if path is missing, leave it to recoverFile)
+		const String tmpPath = String(path) + FILE_TMP_SUFFIX;
+		if (SPIFFS.exists(path) && SPIFFS.exists(tmpPath)) SPIFFS.remove(tmpPath);
+	}
+	return numPersistTargets++;
+}
+
+void markPersistDirty(int8_t id) {	// Schedules writing target id to flash. Returns right away: the write happens in a later idle slot, together with any other changes made in between
+	if (id < 0 || id >= numPersistTargets) return;
+	PersistTarget& target = persistTargets[id];
+	if (!target.dirty) target.tFirstChange = curr_time;
+	target.tLastChange = curr_time;
+	target.dirty = true;
+	++target.changes;
+}
+
+bool isPersistTargetDue(const PersistTarget& target) {
+	return target.dirty && (int32_t)(curr_time - target.tRetry) >= 0 && (curr_time - target.tLastChange >= target.delay || curr_time - target.tFirstChange >= target.maxDelay);
+}
+
+bool persistencePending() {	// Whether processPersistence has work to do right now (scheduler readiness predicate)
+	if (persistFlushing >= 0) return true;
+	for (uint8_t i=0; i<numPersistTargets; ++i) {
+		if (isPersistTargetDue(persistTargets[i])) return true;
+	}
+	return false;
+}
+
+void persistWriteDone(PersistTarget& target) {	// Updates the wear counters (in RAM and in the journal)
+	++target.writes;
+	++target.writesSinceBoot;
+
+	File f = SPIFFS.open(PERSIST_JOURNAL_FILE, "a");
+	if (!f) return;
+	f.write((uint8_t)PERSIST_RECORD_DONE);
+	f.write((const uint8_t*)&target.nameHash, 4);
+	f.write((const uint8_t*)&target.writes, 4);
+	const size_t journalSize = f.size();
+	f.close();
+	if (journalSize > PERSIST_JOURNAL_MAX_SIZE) compactPersistJournal();
+}
+
+void persistWriteFailed(PersistTarget& target) {	// Schedules another try (after PERSIST_RETRY_DELAY)
+	consolePrintF("Couldn't write %s to flash, will try again :(\n", target.name);
+	++target.failures;
+	if (!target.dirty) target.tFirstChange = target.tLastChange = curr_time;	// (Unless there were new changes meanwhile, this is still the same data)
+	target.tRetry = curr_time + PERSIST_RETRY_DELAY;
+	target.dirty = true;
+}
+
+void beginPersistFlush(uint8_t id) {	// Snapshots target id and opens its temp file (or writes it in one go if it's not a file)
+	PersistTarget& target = persistTargets[id];
+	target.dirty = false;	// (Changes from now on need another write)
+	if (!target.path) {
+		if (target.write()) persistWriteDone(target);
+		else persistWriteFailed(target);
+		return;
+	}
+
+	persistBuffer.clear();
+	if (!target.serialize(persistBuffer)) {
+		persistWriteFailed(target);
+		return;
+	}
+	persistFile = SPIFFS.open(String(target.path) + FILE_TMP_SUFFIX, "w");
+	if (!persistFile) {
+		persistWriteFailed(target);
+		return;
+	}
+	persistFlushing = id;
+	persistFilePos = 0;
+}
+
+void continuePersistFlush() {	// Writes the next chunk of the target being flushed, and commits it (through the journal) once it's all in its temp file
+	PersistTarget& target = persistTargets[persistFlushing];
+	const String tmpPath = String(target.path) + FILE_TMP_SUFFIX;
+	const size_t size = persistBuffer.data.size();
+	const size_t len = min((size_t)PERSIST_CHUNK_SIZE, size - persistFilePos);
+	if (len > 0 && persistFile.write(&persistBuffer.data[persistFilePos], len) != len) {
+		persistFile.close();
+		SPIFFS.remove(tmpPath);
+		persistFlushing = -1;
+		persistWriteFailed(target);
+		return;
+	}
+	persistFilePos += len;
+	if (persistFilePos < size) return;
+
+	persistFile.close();
+	persistFlushing = -1;
+	File f = SPIFFS.open(PERSIST_JOURNAL_FILE, "a");
+	if (f) {	// (Without the record, a reset before the rename just loses this write)
+		const uint32_t crc = crc32Update(0, persistBuffer.data.data(), size);
+		const uint8_t pathLen = strlen(target.path);
+		f.write((uint8_t)PERSIST_RECORD_BEGIN);
+		f.write((const uint8_t*)&target.nameHash, 4);
+		f.write((const uint8_t*)&size, 4);
+		f.write((const uint8_t*)&crc, 4);
+		f.write(pathLen);
+		f.write((const uint8_t*)target.path, pathLen);
+		f.close();
+	}
+	if (replaceFile(tmpPath, target.path)) {
+		persistWriteDone(target);
+	} else {
+		persistWriteFailed(target);
+	}
+}
+
+void processPersistence() {	// "persistence.loop()" function (idle task): writes at most PERSIST_CHUNK_SIZE bytes of the next target that's due
+	if (persistFlushing >= 0) {
+		continuePersistFlush();
+		return;
+	}
+	for (uint8_t i=0; i<numPersistTargets; ++i) {
+		if (isPersistTargetDue(persistTargets[i])) {
+			beginPersistFlush(i);
+			return;
+		}
+	}
+}
+
+void flushPersistence() {	// Writes every dirty target right away (eg: before rebooting)
+	while (persistFlushing >= 0) {
+		continuePersistFlush();
+		yield();	// (Big targets take many chunks, don't trip the watchdog)
+	}
+	for (uint8_t i=0; i<numPersistTargets; ++i) {
+		if (!persistTargets[i].dirty) continue;
+		beginPersistFlush(i);
+		while (persistFlushing >= 0) {
+			continuePersistFlush();
+			yield();
+		}
+	}
+}
+
+void printPersistenceJSON(Print& out) {	// Prints the state and wear counters of every target as JSON
+	out.printf(CF("{\"t\":%u,\"flushing\":%d,\"targets\":{"), millis(), persistFlushing);
+	for (uint8_t i=0; i<numPersistTargets; ++i) {
+		const PersistTarget& target = persistTargets[i];
+		out.printf(CF("%s\"%s\":{\"dirty\":%s,\"changes\":%u,\"writesSinceBoot\":%u,\"writes\":%u,\"failures\":%u}"), i? ",":"", target.name, target.dirty? "true":"false", target.changes, target.writesSinceBoot, target.writes, target.failures);
+	}
+	out.printf(CF("}}\n"));
+}
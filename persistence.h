@@ -0,0 +1,74 @@
+/******      Background persistence      ******/
+#ifndef PERSISTENCE_H_
+#define PERSISTENCE_H_
+
+#include "main.h"						// Global includes and definitions
+#include "fileIO.h"						// SPIFFS, replaceFile and CRC-32
+#include <vector>
+
+#define PERSIST_MAX_TARGETS			4
+#define PERSIST_CHUNK_SIZE			256		// (B) Most bytes written to a file per idle slot
+#define PERSIST_DEFAULT_DELAY		2000	// (ms) A target is written once it's gone this long without changes...
+#define PERSIST_DEFAULT_MAX_DELAY	10000	// (ms) ...or this long after its first unsaved change, whatever happens first
+#define PERSIST_RETRY_DELAY			1000	// (ms) How long to wait before trying to write a target again after a failed write
+#define PERSIST_JOURNAL_FILE		"/persist.jnl"	// Commits in flight and wear counters (see processPersistence)
+#define PERSIST_JOURNAL_MAX_SIZE	1024	// (B) The journal is compacted (one wear counter per target) once it grows past this
+#define PERSIST_JOURNAL_MAX_ENTRIES	8		// Max number of different targets the journal keeps wear counters for
+
+typedef bool (*PersistSerializeFunc)(Stream& out);	// Writes the whole state of a target (to RAM, processPersistence then writes it to the file in chunks). Returns false if it couldn't
+typedef bool (*PersistWriteFunc)();					// Writes the state of a target that doesn't live in SPIFFS (eg: the EEPROM) in one go. Returns false if it couldn't
+
+
+/**********************      PersistTarget      **********************/
+struct PersistTarget {	// Piece of state that's saved to flash in the background (see markPersistDirty)
+	const char* name;
+	const char* path;				// SPIFFS file it's written to through serialize (NULL if it's written through write instead)
+	PersistSerializeFunc serialize;
+	PersistWriteFunc write;
+	uint16_t delay, maxDelay;		// (ms) See PERSIST_DEFAULT_DELAY and PERSIST_DEFAULT_MAX_DELAY
+	uint32_t nameHash;				// Identifies the target in the journal
+
+	bool dirty;
+	uint32_t tFirstChange, tLastChange;	// (ms) First and last unsaved change
+	uint32_t tRetry;				// (ms) Not written again before this (after a failed write)
+	uint32_t writes;				// Wear counter: times it was written to flash (ever, kept in the journal)
+	uint32_t changes;				// markPersistDirty calls since boot (changes/writes since boot is how well they're coalesced)
+	uint32_t writesSinceBoot;
+	uint32_t failures;
+};
+
+/**********************      PersistBuffer      **********************/
+class PersistBuffer : public Stream {	// Growable RAM buffer targets are serialized into. Its capacity is kept between flushes, so once it's grown it stops allocating
+public:
+	PersistBuffer() : pos(0) {}
+
+	std::vector<uint8_t> data;
+	size_t pos;	// Read position
+
+	size_t write(uint8_t c) { data.push_back(c); return 1; }
+	size_t write(const uint8_t* buf, size_t len) { data.insert(data.end(), buf, buf+len); return len; }
+	int available() { return data.size() - pos; }
+	int read() { return (pos < data.size())? data[pos++] : -1; }
+	int peek() { return (pos < data.size())? data[pos] : -1; }
+	void flush() {}
+	void clear() { data.clear(); pos = 0; }
+};
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+void setupPersistence();	// Replays the journal (finishing commits interrupted by a reset, discarding half-written files and loading the wear counters) and compacts it. Call it after setupFileIO and before loading any target
+
+
+/*****************************************************/
+/******      Persistence related functions      ******/
+/*****************************************************/
+int8_t addPersistTarget(const char* name, const char* path, PersistSerializeFunc serialize, PersistWriteFunc write=NULL, uint16_t delay=PERSIST_DEFAULT_DELAY, uint16_t maxDelay=PERSIST_DEFAULT_MAX_DELAY);	// Registers a target (path+serialize for SPIFFS files, NULL+NULL+write otherwise) and returns its id (-1 if there's no room left)
+void markPersistDirty(int8_t id);	// Schedules writing target id to flash. Returns right away: the write happens in a later idle slot, together with any other changes made in between
+bool persistencePending();			// Whether processPersistence has work to do right now (scheduler readiness predicate)
+void processPersistence();			// "persistence.loop()" function (idle task): writes at most PERSIST_CHUNK_SIZE bytes of the next target that's due
+void flushPersistence();			// Writes every dirty target right away (eg: before rebooting)
+void printPersistenceJSON(Print& out);	// Prints the state and wear counters of every target as JSON
+
+#endif
@@ -0,0 +1,76 @@
+/******      Loop profiler      ******/
+#include "profiler.h"
+
+ProfileHistogram profileHistograms[N_PROFILE_STAGES];
+const char* const PROGMEM profileStageNames[N_PROFILE_STAGES] = {"GPIO", "audio", "OLED", "ledStrip", "webServer", "WiFi", "persist", "loop"};
+uint32_t tProfilerReset = 0;	// (ms) When the histograms were last cleared
+
+
+/**********************      ProfileHistogram      **********************/
+void ProfileHistogram::reset() {
+	memset(buckets, 0, sizeof(buckets));
+	count = maxUs = 0;
+	minUs = (uint32_t)-1;
+	sumUs = 0;
+}
+
+void ProfileHistogram::record(uint32_t us) {
+	++buckets[bucketOf(us)];
+	++count;
+	sumUs += us;
+	if (us < minUs) minUs = us;
+	if (us > maxUs) maxUs = us;
+}
+
+uint32_t ProfileHistogram::getPercentile(uint8_t p) const {	// Returns (an upper bound of) the p-th percentile
+	if (count == 0) return 0;
+
+	uint32_t target = ((uint64_t)count*p + 99)/100, cumulative = 0;
+	for (uint8_t b=0; b<PROFILER_N_BUCKETS; ++b) {
+		cumulative += buckets[b];
+		if (cumulative >= target) return min(bucketLimit(b), maxUs);	// maxUs is tighter than the bucket limit for the top bucket(s)
+	}
+	return maxUs;
+}
+
+uint8_t ProfileHistogram::bucketOf(uint32_t us) {	// Index of the bucket us falls in
+	const uint8_t S = PROFILER_SUB_BUCKETS_LOG2;
+	if (us < (1u<<(S+1))) return us;	// Small values get one bucket each
+	uint8_t octave = 31 - __builtin_clz(us);	// floor(log2(us))
+	if (octave >= PROFILER_MAX_LOG2) return PROFILER_N_BUCKETS-1;
+	return ((octave - S + 1) << S) + ((us >> (octave - S)) & ((1<<S) - 1));	// Top S bits after the leading 1 select the sub-bucket
+}
+
+uint32_t ProfileHistogram::bucketLimit(uint8_t b) {	// Largest duration that falls in bucket b
+	const uint8_t S = PROFILER_SUB_BUCKETS_LOG2;
+	if (b < (1u<<(S+1))) return b;
+	if (b >= PROFILER_N_BUCKETS-1) return (uint32_t)-1;
+	uint8_t octave = (b >> S) + S - 1, sub = b & ((1<<S) - 1);
+	return (((1u<<S) + sub + 1) << (octave - S)) - 1;
+}
+
+
+/**********************************************/
+/******      Profiler related functions      ******/
+/**********************************************/
+uint32_t profileStage(ProfileStage stage, uint32_t tStart) {	// Records micros()-tStart as one execution of stage and returns micros() (so consecutive stages can be chained)
+	uint32_t tEnd = micros();
+	profileHistograms[stage].record(tEnd - tStart);
+	return tEnd;
+}
+
+void resetProfiler() {	// Clears all the histograms
+	for (ProfileHistogram& h : profileHistograms) {
+		h.reset();
+	}
+	tProfilerReset = millis();
+}
+
+void printProfilerJSON(Print& out) {	// Prints count, min, avg, p99 and max (us) of every stage as JSON
+	out.printf(CF("{\"t\":%u,\"tSinceReset\":%u,\"stages\":{"), millis(), millis()-tProfilerReset);
+	for (uint8_t s=0; s<N_PROFILE_STAGES; ++s) {
+		const ProfileHistogram& h = profileHistograms[s];
+		out.printf(CF("%s\"%s\":{\"count\":%u,\"min\":%u,\"avg\":%u,\"p99\":%u,\"max\":%u}"), s? ",":"", profileStageNames[s], h.getCount(), h.getMin(), h.getAvg(), h.getPercentile(99), h.getMax());
+	}
+	out.printf(CF("}}\n"));
+}
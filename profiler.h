@@ -0,0 +1,44 @@
+/******      Loop profiler      ******/
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "main.h"						// Global includes and definitions
+
+#define PROFILER_SUB_BUCKETS_LOG2	2	// Each power of 2 is split in 2^PROFILER_SUB_BUCKETS_LOG2 buckets (so percentiles are off by at most ~1/2^PROFILER_SUB_BUCKETS_LOG2)
+#define PROFILER_MAX_LOG2			20	// Durations >= 2^PROFILER_MAX_LOG2 us (~1s) all go to the last bucket
+#define PROFILER_N_BUCKETS			(((PROFILER_MAX_LOG2 - PROFILER_SUB_BUCKETS_LOG2 + 1) << PROFILER_SUB_BUCKETS_LOG2) + 1)	// Linear buckets for the smallest values + sub-buckets for every power of 2 + overflow bucket
+
+enum ProfileStage {PROFILE_GPIO=0, PROFILE_AUDIO, PROFILE_OLED, PROFILE_LED_STRIP, PROFILE_WEB_SERVER, PROFILE_WIFI, PROFILE_PERSIST, PROFILE_LOOP, N_PROFILE_STAGES};	// PROFILE_LOOP is a whole pass of the scheduler (excluding the time it sleeps)
+
+
+/**********************      ProfileHistogram      **********************/
+class ProfileHistogram {	// Log-bucketed histogram of durations (us). Fixed size, no heap
+public:
+	ProfileHistogram() { reset(); }
+
+	void reset();
+	void record(uint32_t us);
+	uint32_t getCount() const { return count; }
+	uint32_t getMin() const { return count? minUs : 0; }
+	uint32_t getMax() const { return maxUs; }
+	uint32_t getAvg() const { return count? sumUs/count : 0; }
+	uint32_t getPercentile(uint8_t p) const;	// Returns (an upper bound of) the p-th percentile
+
+protected:
+	uint32_t buckets[PROFILER_N_BUCKETS];
+	uint32_t count, minUs, maxUs;
+	uint64_t sumUs;
+
+	static uint8_t bucketOf(uint32_t us);		// Index of the bucket us falls in
+	static uint32_t bucketLimit(uint8_t b);	// Largest duration that falls in bucket b
+};
+
+
+/**********************************************/
+/******      Profiler related functions      ******/
+/**********************************************/
+uint32_t profileStage(ProfileStage stage, uint32_t tStart);	// Records micros()-tStart as one execution of stage and returns micros() (so consecutive stages can be chained)
+void resetProfiler();				// Clears all the histograms
+void printProfilerJSON(Print& out);	// Prints count, min, avg, p99 and max (us) of every stage as JSON
+
+#endif
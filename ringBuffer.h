@@ -0,0 +1,55 @@
+/******      Lock-free ring buffer      ******/
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+
+/**********************      SPSCRingBuffer      **********************/
+template<typename T, uint16_t SIZE> class SPSCRingBuffer {	// Lock-free Single-Producer/Single-Consumer ring buffer (eg: producer is an ISR, consumer is the main loop). SIZE must be a power of 2
+	static_assert((SIZE & (SIZE-1)) == 0, "SPSCRingBuffer SIZE must be a power of 2");
+
+public:
+	SPSCRingBuffer() : head(0), tail(0), overruns(0) {}
+
+	inline __attribute__((always_inline)) bool push(T val) {	// (Producer only) Appends val. If the buffer is full, val is dropped, the overrun counter is increased and it returns false. Always inlined so ISRs don't call into flash
+		const uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= SIZE) {
+			overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+		buf[h & (SIZE-1)] = val;
+		head.store(h + 1, std::memory_order_release);	// Publish val only after it's been written
+		return true;
+	}
+
+	uint32_t available() const {	// (Consumer only) Returns how many items are ready to be read
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+	}
+
+	uint16_t peek(const T*& span) const {	// (Consumer only) Points span to the oldest unread item and returns how many unread items are contiguous from there (no copy). Call consume() once done with them
+		const uint32_t t = tail.load(std::memory_order_relaxed);
+		const uint32_t n = head.load(std::memory_order_acquire) - t;
+		const uint16_t idx = t & (SIZE-1);
+		span = &buf[idx];
+		return (n < (uint32_t)(SIZE - idx))? n : SIZE - idx;
+	}
+
+	void consume(uint32_t n) {	// (Consumer only) Releases the n oldest items so the producer can overwrite them
+		tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+
+	uint32_t getTotalPushed() const { return head.load(std::memory_order_relaxed); }	// Total number of items ever pushed (wraps around at 2^32), can be used as a sample clock
+	uint32_t getOverruns() const { return overruns.load(std::memory_order_relaxed); }	// Total number of items dropped because the consumer fell behind
+	static constexpr uint16_t capacity() { return SIZE; }
+
+protected:
+	T buf[SIZE];
+	std::atomic<uint32_t> head;		// Free-running count of items written (only modified by the producer)
+	std::atomic<uint32_t> tail;		// Free-running count of items read (only modified by the consumer)
+	std::atomic<uint32_t> overruns;	// Number of items dropped (only modified by the producer)
+};
+
+#endif
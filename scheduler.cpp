@@ -0,0 +1,127 @@
+/******      Cooperative scheduler      ******/
+#include "scheduler.h"
+
+SchedulerTask schedulerTasks[SCHEDULER_MAX_TASKS];
+uint8_t numSchedulerTasks = 0;
+
+
+/***********************************************/
+/******      Scheduler related functions      ******/
+/***********************************************/
+bool addSchedulerTask(const char* name, SchedulerTaskFunc func, uint16_t period, SchedulerReadyFunc ready, uint16_t deadline, ProfileStage stage) {	// Registers a task. Tasks run in the order they were added (so that's their priority). Returns false if there's no room left
+	if (numSchedulerTasks >= SCHEDULER_MAX_TASKS) {
+		consolePrintF("Can't add task %s to the scheduler, all %d slots are taken :(\n", name, SCHEDULER_MAX_TASKS);
+		return false;
+	}
+
+	SchedulerTask& task = schedulerTasks[numSchedulerTasks++];
+	task.name = name;
+	task.func = func;
+	task.period = period;
+	task.ready = ready;
+	task.deadline = deadline;
+	task.stage = stage;
+	task.idle = false;
+	task.tNextRun = millis();
+	task.runs = task.missedDeadlines = task.maxLateness = 0;
+	return true;
+}
+
+bool addSchedulerIdleTask(const char* name, SchedulerTaskFunc func, SchedulerReadyFunc ready, ProfileStage stage) {	// Registers a task that only runs (if ready() returns true) after the due tasks of a pass, and only if no other task is due for SCHEDULER_MIN_IDLE_SLOT ms. For background work that can wait, so it never delays the other tasks
+	if (!addSchedulerTask(name, func, 0, ready, (uint16_t)-1, stage)) return false;
+	schedulerTasks[numSchedulerTasks-1].idle = true;
+	return true;
+}
+
+uint32_t schedulerSleepTime() {	// (ms) How long until the next task is due (at most SCHEDULER_MAX_SLEEP if any task has a readiness predicate, -1 if there are no tasks)
+	uint32_t tSleep = (uint32_t)-1;
+	for (uint8_t i=0; i<numSchedulerTasks; ++i) {
+		const SchedulerTask& task = schedulerTasks[i];
+		if (task.ready) tSleep = min(tSleep, (uint32_t)SCHEDULER_MAX_SLEEP);
+		if (task.period > 0) tSleep = min(tSleep, ((int32_t)(task.tNextRun - curr_time) > 0)? task.tNextRun - curr_time : 0);
+	}
+	return tSleep;
+}
+
+void runScheduler() {	// Runs every task that is due (in priority order) and then sleeps until the next one is (at most SCHEDULER_MAX_SLEEP ms if any task has a readiness predicate)
+	uint32_t tDue[SCHEDULER_MAX_TASKS];	// (ms) When each task became due
+	bool isDue[SCHEDULER_MAX_TASKS];
+	uint32_t tPassStart = micros();
+	bool anyDue = false;
+
+	curr_time = millis();
+	for (uint8_t i=0; i<numSchedulerTasks; ++i) {	// Decide which tasks are due before running any, so a long task doesn't make the ones after it look late when they weren't due yet
+		const SchedulerTask& task = schedulerTasks[i];
+		if (task.idle) {	// (They run after the others, see below)
+			isDue[i] = false;
+			continue;
+		} else if (task.period > 0 && (int32_t)(curr_time - task.tNextRun) >= 0) {
+			tDue[i] = task.tNextRun;
+		} else if (task.ready && task.ready()) {
+			tDue[i] = curr_time;
+		} else {
+			isDue[i] = false;
+			continue;
+		}
+		isDue[i] = anyDue = true;
+	}
+
+	for (uint8_t i=0; i<numSchedulerTasks; ++i) {
+		if (!isDue[i]) continue;
+		SchedulerTask& task = schedulerTasks[i];
+
+		curr_time = millis();
+		uint32_t lateness = curr_time - tDue[i];
+		if (lateness > task.deadline) ++task.missedDeadlines;
+		if (lateness > task.maxLateness) task.maxLateness = lateness;
+
+		uint32_t tStart = micros();
+		task.func();
+		profileStage(task.stage, tStart);
+		++task.runs;
+
+		if (task.period > 0 && (int32_t)(curr_time - task.tNextRun) >= 0) {	// (Don't push tNextRun back if it only ran because it was ready)
+			task.tNextRun += task.period;
+			if ((int32_t)(curr_time - task.tNextRun) >= 0) task.tNextRun = curr_time + task.period;	// Fell behind by more than a period: skip the missed runs instead of running them back to back
+		}
+	}
+	if (anyDue) profileStage(PROFILE_LOOP, tPassStart);
+
+	// Idle slot: nothing else is due for a while (whether or not other tasks ran in this pass: with the webServer polling every SCHEDULER_MAX_SLEEP ms, passes where nothing runs hardly ever happen)
+	curr_time = millis();
+	if (schedulerSleepTime() >= SCHEDULER_MIN_IDLE_SLOT) {
+		for (uint8_t i=0; i<numSchedulerTasks; ++i) {
+			SchedulerTask& task = schedulerTasks[i];
+			if (!task.idle || !task.ready()) continue;
+
+			uint32_t tStart = micros();
+			task.func();
+			profileStage(task.stage, tStart);
+			++task.runs;
+			curr_time = millis();
+			if (schedulerSleepTime() < SCHEDULER_MIN_IDLE_SLOT) break;	// The slot is over
+		}
+	}
+
+	// Sleep until the next task is due
+	curr_time = millis();
+	uint32_t tSleep = schedulerSleepTime();
+	if (tSleep > 0 && tSleep != (uint32_t)-1) {
+		delay(tSleep);	// delay() lets the WiFi stack run while we wait
+	} else {
+		yield();
+	}
+}
+
+void printSchedulerJSON(Print& out) {	// Prints period, deadline, number of runs and missed deadlines of every task as JSON
+	out.printf(CF("{\"t\":%u,\"tasks\":{"), millis());
+	for (uint8_t i=0; i<numSchedulerTasks; ++i) {
+		const SchedulerTask& task = schedulerTasks[i];
+		if (task.idle) {
+			out.printf(CF("%s\"%s\":{\"idle\":true,\"runs\":%u}"), i? ",":"", task.name, task.runs);
+			continue;
+		}
+		out.printf(CF("%s\"%s\":{\"period\":%u,\"deadline\":%u,\"runs\":%u,\"missedDeadlines\":%u,\"maxLateness\":%u}"), i? ",":"", task.name, task.period, task.deadline, task.runs, task.missedDeadlines, task.maxLateness);
+	}
+	out.printf(CF("}}\n"));
+}
@@ -0,0 +1,41 @@
+/******      Cooperative scheduler      ******/
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "main.h"						// Global includes and definitions
+#include "profiler.h"					// Every task's run time is recorded in its profiler stage
+
+#define SCHEDULER_MAX_TASKS		8
+#define SCHEDULER_MAX_SLEEP		5		// (ms) Longest the loop sleeps if there are tasks with a readiness predicate (that's how often they get polled)
+#define SCHEDULER_MIN_IDLE_SLOT	3		// (ms) Idle tasks only run if no other task is due for at least this long
+
+typedef void (*SchedulerTaskFunc)();	// Task body (the module's "process" function)
+typedef bool (*SchedulerReadyFunc)();	// Readiness predicate: returns whether the task has work to do right now
+
+
+/**********************      SchedulerTask      **********************/
+struct SchedulerTask {
+	const char* name;
+	SchedulerTaskFunc func;
+	uint16_t period;			// (ms) Run every period ms (0 = only when ready() returns true)
+	SchedulerReadyFunc ready;	// (Optional) Run as soon as it returns true, regardless of period
+	uint16_t deadline;			// (ms) Max delay from the moment the task is due until it starts running. Longer delays count as missed deadlines
+	ProfileStage stage;			// Profiler stage the task's run time is recorded in
+	bool idle;					// Only runs in idle slots (see addSchedulerIdleTask)
+
+	uint32_t tNextRun;			// (ms) When the task is due next (only if period > 0)
+	uint32_t runs;				// Number of times the task ran
+	uint32_t missedDeadlines;	// Number of times the task started running more than deadline ms after it was due
+	uint32_t maxLateness;		// (ms) Longest delay from the moment the task was due until it started running
+};
+
+
+/***********************************************/
+/******      Scheduler related functions      ******/
+/***********************************************/
+bool addSchedulerTask(const char* name, SchedulerTaskFunc func, uint16_t period, SchedulerReadyFunc ready, uint16_t deadline, ProfileStage stage);	// Registers a task. Tasks run in the order they were added (so that's their priority). Returns false if there's no room left
+bool addSchedulerIdleTask(const char* name, SchedulerTaskFunc func, SchedulerReadyFunc ready, ProfileStage stage);	// Registers a task that only runs (if ready() returns true) after the due tasks of a pass, and only if no other task is due for SCHEDULER_MIN_IDLE_SLOT ms. For background work that can wait, so it never delays the other tasks
+void runScheduler();				// Runs every task that is due (in priority order) and then sleeps until the next one is (at most SCHEDULER_MAX_SLEEP ms if any task has a readiness predicate)
+void printSchedulerJSON(Print& out);// Prints period, deadline, number of runs and missed deadlines of every task as JSON
+
+#endif
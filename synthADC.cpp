@@ -0,0 +1,67 @@
+/******      Synthetic ADC source      ******/
+#include "synthADC.h"
+#include "FFT.h"		// F_SAMPLING
+
+#define SYNTH_ADC_PHASE_INC(f)	((uint32_t)((f)*4294967296.0/F_SAMPLING))	// Phase accumulator increment (per sample) for an oscillator of frequency f (Hz)
+
+struct SynthADCosc {	// Phase accumulator oscillator: the top SYNTH_ADC_SINE_BITS of phase index the sine table
+	uint32_t phase;
+	uint32_t inc;
+	int16_t amplitude;	// Peak amplitude (in ADC counts)
+};
+
+int16_t synthADCsine[1<<SYNTH_ADC_SINE_BITS];	// Full sine period, Q15
+SynthADCosc synthADCoscs[] = {
+	{0, SYNTH_ADC_PHASE_INC(110), 300},		// Bass
+	{0, SYNTH_ADC_PHASE_INC(440), 150},
+	{0, SYNTH_ADC_PHASE_INC(2500), 60},
+};
+SynthADCosc synthADCkick = {0, SYNTH_ADC_PHASE_INC(60), 1500};
+uint32_t synthADCkickEnvelope = 0;	// Q15
+uint32_t synthADCsampleCount = 0;
+uint32_t synthADCnoise = 0xACE1;	// LFSR state
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+void setupSynthADC() {	// Builds the sine table and resets the oscillators
+	for (uint16_t i=0; i<(1<<SYNTH_ADC_SINE_BITS); ++i) {
+		synthADCsine[i] = (int16_t)(32767*sin(2*PI*i/(1<<SYNTH_ADC_SINE_BITS)));
+	}
+	for (SynthADCosc& osc : synthADCoscs) {
+		osc.phase = 0;
+	}
+	synthADCkickEnvelope = 0;
+	synthADCsampleCount = 0;
+}
+
+
+/***************************************************/
+/******      Synthetic ADC related functions      ******/
+/***************************************************/
+static inline ICACHE_RAM_ATTR int32_t synthADCoscStep(SynthADCosc& osc) {	// Returns the oscillator's current value (ADC counts) and advances its phase
+	int32_t val = ((int32_t)synthADCsine[osc.phase >> (32-SYNTH_ADC_SINE_BITS)] * osc.amplitude) >> 15;
+	osc.phase += osc.inc;
+	return val;
+}
+
+uint16_t ICACHE_RAM_ATTR synthADCsample() {	// Returns the next 12-bit sample of the test signal (a bass line, two steady tones, some noise and a decaying 60Hz kick every beat), as if it had been read from the external ADC
+	int32_t val = SYNTH_ADC_MIDSCALE;
+
+	for (SynthADCosc& osc : synthADCoscs) {
+		val += synthADCoscStep(osc);
+	}
+
+	if (synthADCsampleCount++ % (uint32_t)(F_SAMPLING*60/SYNTH_ADC_BPM) == 0) {	// Beat: retrigger the kick
+		synthADCkickEnvelope = 1<<15;
+		synthADCkick.phase = 0;
+	}
+	val += (synthADCoscStep(synthADCkick) * (int32_t)synthADCkickEnvelope) >> 15;
+	synthADCkickEnvelope = (synthADCkickEnvelope * SYNTH_ADC_KICK_DECAY_Q15) >> 15;
+
+	synthADCnoise = (synthADCnoise >> 1) ^ (-(synthADCnoise & 1) & 0xB400);	// 16-bit Galois LFSR
+	val += (int32_t)(synthADCnoise & 0x3F) - 32;
+
+	return constrain(val, 0, 4095);
+}
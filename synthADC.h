@@ -0,0 +1,24 @@
+/******      Synthetic ADC source      ******/
+#ifndef SYNTH_ADC_H_
+#define SYNTH_ADC_H_
+
+#include "main.h"				// Global includes and definitions
+
+#define SYNTH_ADC_BPM			120		// Tempo of the synthetic kick drum
+#define SYNTH_ADC_MIDSCALE		2048	// Output is centered around the MCP3201's mid-scale (12-bit ADC, same as the real microphone front end)
+#define SYNTH_ADC_SINE_BITS		8		// Size (log2) of the RAM sine table the oscillators use (flash can't be read from the ISR while SPIFFS is writing)
+#define SYNTH_ADC_KICK_DECAY_Q15	32700	// Per-sample decay of the kick's envelope (Q15: 32700/32768 -> ~48ms time constant at 10kHz)
+
+
+/***************************************************/
+/******            SETUP FUNCTIONS            ******/
+/***************************************************/
+void setupSynthADC();	// Builds the sine table and resets the oscillators
+
+
+/***************************************************/
+/******      Synthetic ADC related functions      ******/
+/***************************************************/
+uint16_t ICACHE_RAM_ATTR synthADCsample();	// Returns the next 12-bit sample of the test signal (a bass line, two steady tones, some noise and a decaying 60Hz kick every beat), as if it had been read from the external ADC
+
+#endif
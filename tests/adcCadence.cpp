@@ -0,0 +1,53 @@
+/******      ADC cadence test: sample_isr has to keep sampling at F_SAMPLING while frames go out through the strip method the firmware was built with      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "GPIO.h"
+#include "audio.h"
+#include "ledStrip.h"
+#include "scheduler.h"
+
+#define CADENCE_RUN_MS	10000	// (ms) Long enough for hundreds of frames (the default effect list draws on every frame)
+
+#if LED_STRIP_METHOD == LED_STRIP_METHOD_DMA
+#define CADENCE_METHOD_NAME	"DMA"
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_ASYNC_UART
+#define CADENCE_METHOD_NAME	"AsyncUart"
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_UART
+#define CADENCE_METHOD_NAME	"Uart"
+#elif LED_STRIP_METHOD == LED_STRIP_METHOD_BITBANG
+#define CADENCE_METHOD_NAME	"BitBang"
+#else
+#define CADENCE_METHOD_NAME	"Null"
+#endif
+
+
+int main() {
+	hostUseVirtualClock(true);	// Timer1 fires sample_isr every 100us of virtual time, including while Show blocks (see the method models in host/NeoPixelBus.h)
+	curr_time = millis();
+	setupIOpins();
+	setupAudio();
+	setupLedStrip();
+	addSchedulerTask("audio",    processAudio,    0,                        audioFrameReady, 20, PROFILE_AUDIO);
+	addSchedulerTask("ledStrip", processLedStrip, LED_STRIP_FRAME_INTERVAL, NULL,            5,  PROFILE_LED_STRIP);
+
+	while (millis() < CADENCE_RUN_MS) runScheduler();
+
+	const uint32_t expirations = hostTimerExpirations(), serviced = hostTimerServiced(), lost = expirations - serviced;
+	const uint32_t expected = (uint64_t)millis()*F_SAMPLING/1000;
+	printf("%s: %u frames pushed (%u deferred), Show blocked for %u ms; %u timer1 expirations, %u samples lost, %u overruns\n",
+		CADENCE_METHOD_NAME, ledFramesPushed, ledFramesDeferred, HostNeoMethod::blockedUs/1000, expirations, lost, adcRing.getOverruns());
+
+	CHECK_MSG(ledFramesPushed >= CADENCE_RUN_MS/((N_PIXELS*HOST_NEO_US_PER_PIXEL + HOST_NEO_RESET_US)/1000 + LED_STRIP_FRAME_INTERVAL), "Only %u frames pushed", ledFramesPushed);
+	CHECK_MSG(expirations + 1 >= expected && expirations <= expected + 1, "timer1 expired %u times in %u ms", expirations, millis());	// (The timer itself is never late)
+	CHECK_MSG(adcRing.getOverruns() == 0, "%u overruns", adcRing.getOverruns());	// The audio task keeps up with whatever was sampled
+	CHECK_MSG(adcRing.getTotalPushed() == serviced, "%u samples pushed, sample_isr ran %u times", adcRing.getTotalPushed(), serviced);
+#if LED_STRIP_METHOD == LED_STRIP_METHOD_BITBANG
+	// Interrupts are disabled for the whole frame, so all but one of the samples due meanwhile are lost (that's why it's only for debugging, see ledStrip.h)
+	const uint32_t samplesPerFrame = (uint64_t)N_PIXELS*HOST_NEO_US_PER_PIXEL*F_SAMPLING/1000000;
+	CHECK_MSG(lost >= ledFramesPushed*(samplesPerFrame - 2), "Only %u samples lost over %u bit-banged frames", lost, ledFramesPushed);
+#else
+	CHECK_MSG(lost == 0, "%u samples lost", lost);
+#endif
+
+	return hostTestResult("adcCadence_" CADENCE_METHOD_NAME);
+}
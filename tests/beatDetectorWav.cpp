@@ -0,0 +1,173 @@
+/******      BeatDetector test: feeds a WAV file through adcRing and processAudio (the real STFT, bands and detector) and checks the onsets and tempo      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "GPIO.h"
+#include "audio.h"
+#include <vector>
+#include <string>
+
+#define CLICK_TRACK_BPM			128		// Tempo of the synthetic fixture (not a multiple of the hop, so the kicks fall anywhere within a frame)
+#define CLICK_TRACK_SECONDS		20
+#define CLICK_TRACK_T_FIRST		500		// (ms) First kick
+#define ONSET_TOLERANCE			(2*1000*STFT_HOP_SIZE/F_SAMPLING)	// (ms) How far from a kick its onset may be reported: a frame is stamped with its newest sample, so up to one hop late, plus one hop for the flux to rise
+#define WARMUP_MS				2000	// (ms) The adaptive threshold needs a second or so of flux history before it can be trusted
+#define MIN_DETECTED_RATIO		0.9		// At least this fraction of the kicks after WARMUP_MS must be detected...
+#define MAX_SPURIOUS_ONSETS		2		// ...with at most this many onsets that aren't near any kick
+
+
+/*****************************************/
+/******      WAV files (PCM16)      ******/
+/*****************************************/
+struct WavHeader {	// Canonical 44-byte RIFF/WAVE header (PCM)
+	char riff[4]; uint32_t riffSize; char wave[4];
+	char fmt[4]; uint32_t fmtSize; uint16_t format, channels; uint32_t sampleRate, byteRate; uint16_t blockAlign, bitsPerSample;
+	char data[4]; uint32_t dataSize;
+};
+
+bool writeWav(const char* path, const std::vector<int16_t>& samples, uint32_t sampleRate) {	// Writes mono PCM16 samples to path
+	const WavHeader h = {{'R','I','F','F'}, (uint32_t)(36 + 2*samples.size()), {'W','A','V','E'}, {'f','m','t',' '}, 16, 1, 1, sampleRate, 2*sampleRate, 2, 16, {'d','a','t','a'}, (uint32_t)(2*samples.size())};
+	FILE* f = fopen(path, "wb");
+	if (!f) return false;
+	const bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(samples.data(), 2, samples.size(), f) == samples.size();
+	return (fclose(f) == 0) && ok;
+}
+
+bool readWav(const char* path, std::vector<int16_t>& samples) {	// Reads a PCM16 WAV (any rate, mono or stereo) into samples: mixed down to mono and resampled (linearly) to F_SAMPLING
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+	char id[4];
+	uint32_t size, sampleRate = 0;
+	uint16_t channels = 0, bits = 0;
+	std::vector<int16_t> raw;
+	bool ok = fread(id, 4, 1, f) == 1 && memcmp(id, "RIFF", 4) == 0 && fread(&size, 4, 1, f) == 1 && fread(id, 4, 1, f) == 1 && memcmp(id, "WAVE", 4) == 0;
+	while (ok && raw.empty() && fread(id, 4, 1, f) == 1 && fread(&size, 4, 1, f) == 1) {	// Walk the chunks (there may be others, eg: LIST, between fmt and data)
+		if (memcmp(id, "fmt ", 4) == 0) {
+			uint16_t format;
+			uint32_t byteRate;
+			ok = size >= 16 && fread(&format, 2, 1, f) == 1 && fread(&channels, 2, 1, f) == 1 && fread(&sampleRate, 4, 1, f) == 1 && fread(&byteRate, 4, 1, f) == 1 && fseek(f, 2, SEEK_CUR) == 0 && fread(&bits, 2, 1, f) == 1 && fseek(f, size - 16 + (size & 1), SEEK_CUR) == 0;
+			ok = ok && format == 1 && bits == 16 && channels >= 1;
+		} else if (memcmp(id, "data", 4) == 0) {
+			raw.resize(size/2);
+			ok = channels > 0 && fread(raw.data(), 2, raw.size(), f) == raw.size();
+		} else {
+			ok = fseek(f, size + (size & 1), SEEK_CUR) == 0;
+		}
+	}
+	fclose(f);
+	if (!ok || raw.empty() || sampleRate == 0) return false;
+
+	const size_t nFrames = raw.size()/channels, nOut = (uint64_t)nFrames*F_SAMPLING/sampleRate;
+	samples.resize(nOut);
+	for (size_t i=0; i<nOut; ++i) {
+		const double pos = (double)i*sampleRate/F_SAMPLING, frac = pos - (size_t)pos;
+		const size_t j = min((size_t)pos, nFrames-1), k = min(j+1, nFrames-1);
+		double a = 0, b = 0;
+		for (uint16_t c=0; c<channels; ++c) {
+			a += raw[j*channels + c];
+			b += raw[k*channels + c];
+		}
+		samples[i] = ((1-frac)*a + frac*b)/channels;
+	}
+	return true;
+}
+
+std::vector<int16_t> clickTrack(std::vector<uint32_t>& kicks) {	// Synthetic fixture: a steady bass line and tone under noise, with a kick drum (decaying 60Hz thump with a click on top) every beat. kicks gets the time (ms) of each kick
+	std::vector<int16_t> samples(CLICK_TRACK_SECONDS*(uint32_t)F_SAMPLING);
+	uint32_t noise = 1;
+	const double beatPeriod = 60000.0/CLICK_TRACK_BPM;
+	for (double t=CLICK_TRACK_T_FIRST; t<CLICK_TRACK_SECONDS*1000; t+=beatPeriod) kicks.push_back(t);
+	for (size_t i=0, nextKick=0; i<samples.size(); ++i) {
+		const double t = i*1000/F_SAMPLING;	// (ms)
+		while (nextKick+1 < kicks.size() && t >= kicks[nextKick+1]) ++nextKick;
+		noise = noise*1664525 + 1013904223;
+		double s = 1500*sin(2*M_PI*110*t/1000) + 800*sin(2*M_PI*1000*t/1000) + 300*((int32_t)(noise >> 16) - 32768)/32768.0;
+		if (t >= kicks[nextKick]) {
+			const double dt = t - kicks[nextKick];
+			s += 12000*exp(-dt/60)*sin(2*M_PI*60*dt/1000) + ((dt < 5)? 4000*((int32_t)(noise >> 8 & 0xFFFF) - 32768)/32768.0 : 0);
+		}
+		samples[i] = constrain(s, -32768.0, 32767.0);
+	}
+	return samples;
+}
+
+
+/*********************************************/
+/******      Feeding the audio stage      ******/
+/*********************************************/
+struct DetectedOnset {
+	uint32_t t;	// (ms) Frame time (newest sample in the window)
+	float bpm;	// Tempo estimate right after it
+};
+
+float runAudio(const std::vector<int16_t>& samples, std::vector<DetectedOnset>& onsets) {	// Pushes samples (as 12-bit ADC counts) into adcRing one hop at a time, at F_SAMPLING on the virtual clock, running processAudio after every hop. Returns the final tempo estimate
+	hostUseVirtualClock(true);
+	curr_time = millis();
+	setupAudio();
+	uint32_t lastId = getAudioFrame().id;
+	for (size_t i=0; i+stftHopSize<=samples.size(); i+=stftHopSize) {
+		for (uint16_t j=0; j<stftHopSize; ++j) {
+			adcRing.push(2048 + samples[i+j]/16);
+			hostAdvanceMicros(1000000/F_SAMPLING);
+		}
+		curr_time = millis();
+		processAudio();
+		const AudioFrame& frame = getAudioFrame();
+		if (frame.id != lastId && frame.onset) onsets.push_back({frame.t, frame.bpm});
+		lastId = frame.id;
+	}
+	return getAudioFrame().bpm;
+}
+
+
+int main(int argc, char* argv[]) {
+	std::vector<int16_t> samples;
+	std::vector<uint32_t> kicks;
+	std::vector<DetectedOnset> onsets;
+
+	if (argc > 1) {	// Recorded audio: just print what was detected (there's no ground truth to check against)
+		if (!readWav(argv[1], samples)) {
+			fprintf(stderr, "Couldn't read %s (PCM16 WAV)\n", argv[1]);
+			return 1;
+		}
+		const float bpm = runAudio(samples, onsets);
+		for (const DetectedOnset& o : onsets) printf("onset @%6u ms (%5.1f BPM)\n", o.t, o.bpm);
+		printf("%u onsets, final tempo: %.1f BPM\n", (uint32_t)onsets.size(), bpm);
+		return 0;
+	}
+
+	// Synthetic fixture, through a WAV file so the reader is exercised too
+	const std::string path = std::string(hostSpiffsRoot()) + "/clickTrack.wav";
+	const std::vector<int16_t> fixture = clickTrack(kicks);
+	CHECK(writeWav(path.c_str(), fixture, F_SAMPLING));
+	CHECK(readWav(path.c_str(), samples));
+	CHECK(samples == fixture);
+	remove(path.c_str());
+
+	const float bpm = runAudio(samples, onsets);
+
+	uint32_t expected = 0, detected = 0, spurious = 0;
+	for (uint32_t tKick : kicks) {
+		if (tKick < WARMUP_MS || tKick + ONSET_TOLERANCE > CLICK_TRACK_SECONDS*1000) continue;
+		++expected;
+		bool found = false;
+		for (const DetectedOnset& o : onsets) found |= (o.t >= tKick && o.t <= tKick + ONSET_TOLERANCE);
+		if (found) ++detected; else printf("Missed the kick @%u ms\n", tKick);
+	}
+	for (const DetectedOnset& o : onsets) {
+		bool nearKick = false;
+		for (uint32_t tKick : kicks) nearKick |= (o.t >= tKick && o.t <= tKick + ONSET_TOLERANCE);
+		if (!nearKick) {
+			++spurious;
+			printf("Spurious onset @%u ms\n", o.t);
+		}
+	}
+	printf("%u/%u kicks detected, %u spurious onsets, final tempo: %.1f BPM (expected %u)\n", detected, expected, spurious, bpm, CLICK_TRACK_BPM);
+	CHECK_MSG(detected >= MIN_DETECTED_RATIO*expected, "%u of %u kicks detected", detected, expected);
+	CHECK_MSG(spurious <= MAX_SPURIOUS_ONSETS, "%u spurious onsets", spurious);
+	// Onsets are only known to the hop, so the beat interval is seen as a whole number of hops: the tempo must be between those of the two nearest ones (eg: 18 and 19 hops for 128 BPM, ie 123.4 to 130.2 BPM)
+	const double hopMs = 1000.0*STFT_HOP_SIZE/F_SAMPLING, beatHops = 60000.0/CLICK_TRACK_BPM/hopMs;
+	const double bpmMin = floor(60000/(ceil(beatHops)*hopMs)), bpmMax = ceil(60000/(floor(beatHops)*hopMs));	// (The tempo histogram has 1 BPM bins)
+	CHECK_MSG(bpm >= bpmMin && bpm <= bpmMax, "Final tempo %.1f BPM, expected %u (%.0f to %.0f at this hop size)", bpm, CLICK_TRACK_BPM, bpmMin, bpmMax);
+
+	return hostTestResult("beatDetectorWav");
+}
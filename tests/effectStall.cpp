@@ -0,0 +1,87 @@
+/******      Stall test: the main loop stalls for a while (eg: a long SPIFFS write) and the LED effect has to resync without a catch-up burst      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "ledStrip.h"
+
+#define STALL_TICK_INTERVAL	20		// (ms) tickInterval of the test effect (longer than LED_STRIP_FRAME_INTERVAL, so not every frame advances it)
+#define STALL_LONG_MS		5000	// (ms) Way more than LED_EFFECT_MAX_TICKS ticks
+#define STALL_SHORT_MS		500		// (ms) Less than LED_EFFECT_MAX_TICKS ticks
+
+
+/**********************      EffectCounter      **********************/
+class EffectCounter : public LedStripEffect {	// Never ends, counts its effectFunc calls and ticks, and draws something different on every call (so every call needs a Show)
+public:
+	EffectCounter() : LedStripEffect(STALL_TICK_INTERVAL) { transitionType = LED_TRANSITION_CUT; }
+	LED_EFFECT_DECLARE("Counter");
+
+	uint32_t calls = 0, ticks = 0, lastTicks = 0;
+	uint32_t nextIteration() const { return tNextIteration; }
+
+	void resetCounters() {}
+	bool effectFunc(uint16_t t) {
+		++calls;
+		ticks += t;
+		lastTicks = t;
+		frame->SetPixelColor(0, RgbColor(calls));
+		return false;
+	}
+};
+constexpr char EffectCounter::compressedName[];
+const char PROGMEM EffectCounter::strReadableEffectName[] = {"Counter"};
+const char PROGMEM EffectCounter::strReadableEffectDesc[] = {"Test effect"};
+const LedEffectInfo EffectCounter::info = {compressedName, strReadableEffectName, strReadableEffectDesc, NULL, 0, &newLedEffect<EffectCounter>};
+
+EffectCounter* effect;
+
+
+/*******************************************/
+/******      Test helper functions      ******/
+/*******************************************/
+void advance(uint32_t ms) {	// Moves the clock forward without running the loop (ie: stalls)
+	hostAdvanceMicros(ms*1000);
+	curr_time = millis();
+}
+
+void runFor(uint32_t ms) {	// Runs processLedStrip every LED_STRIP_FRAME_INTERVAL for ms
+	for (uint32_t t=0; t<ms; t+=LED_STRIP_FRAME_INTERVAL) {
+		advance(LED_STRIP_FRAME_INTERVAL);
+		processLedStrip();
+	}
+}
+
+void checkStall(uint32_t stallMs) {	// Stalls for stallMs and checks the next frame runs the effect once (skipping ahead), Shows at most once and leaves the effect in sync with the clock
+	const uint32_t calls = effect->calls, shows = NeoNullMethod::updateCount;
+	const uint32_t expectedTicks = min((uint32_t)LED_EFFECT_MAX_TICKS, (curr_time + stallMs - effect->nextIteration())/STALL_TICK_INTERVAL + 1);
+
+	advance(stallMs);
+	processLedStrip();
+	CHECK_MSG(effect->calls == calls + 1, "%u-ms stall: %u effectFunc calls, expected 1", stallMs, effect->calls - calls);
+	CHECK_MSG(effect->lastTicks == expectedTicks, "%u-ms stall: advanced %u ticks, expected %u", stallMs, effect->lastTicks, expectedTicks);
+	CHECK_MSG(NeoNullMethod::updateCount - shows <= 1, "%u-ms stall: %u Shows", stallMs, NeoNullMethod::updateCount - shows);
+	CHECK_MSG((int32_t)(effect->nextIteration() - curr_time) > 0 && effect->nextIteration() - curr_time <= STALL_TICK_INTERVAL, "%u-ms stall: tNextIteration=%u at t=%u", stallMs, effect->nextIteration(), curr_time);
+
+	// No catch-up afterwards: back to one tick per tickInterval
+	const uint32_t callsAfter = effect->calls, ticksAfter = effect->ticks;
+	runFor(1000);
+	CHECK_MSG(effect->ticks - ticksAfter == 1000/STALL_TICK_INTERVAL, "%u-ms stall: %u ticks in the next second, expected %u", stallMs, effect->ticks - ticksAfter, 1000/STALL_TICK_INTERVAL);
+	CHECK_MSG(effect->calls - callsAfter == effect->ticks - ticksAfter, "%u-ms stall: %u ticks in %u calls in the next second", stallMs, effect->ticks - ticksAfter, effect->calls - callsAfter);
+}
+
+
+int main() {
+	hostUseVirtualClock(true);
+	curr_time = millis();
+	setupLedStrip();
+	stripEffects.clear();
+	effect = new EffectCounter();
+	stripEffects.addEffect(effect);
+	stripEffects.restartEffectList();
+
+	runFor(1000);
+	CHECK_MSG(effect->ticks >= 1000/STALL_TICK_INTERVAL, "%u ticks in the first second", effect->ticks);
+
+	checkStall(STALL_LONG_MS);
+	checkStall(STALL_SHORT_MS);
+
+	return hostTestResult("effectStall");
+}
@@ -0,0 +1,56 @@
+/******      FFT accuracy test: the fixed-point backend against the double-precision reference, bin by bin      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "FFT.h"
+
+#define FFT_TOLERANCE_PEAK	0.001	// Max |fixed - double| of any bin, relative to the peak of the reference spectrum (-60dB. Q15 twiddles and block floating point scaling stay below ~0.05%)
+#define FFT_TOLERANCE_ABS	1.0		// ...plus this much (ADC counts), for the rounding of the window and the magnitudes, which only matters for very quiet inputs
+
+
+/*********************************************/
+/******      Test signals (ADC counts)      ******/
+/*********************************************/
+typedef void (*SignalFunc)(int16_t* x);
+
+void sineOnBin(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = 2000*sin(2*M_PI*20*i/N_FFT); }
+void sineOffBin(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = 1500*sin(2*M_PI*37.5*i/N_FFT + 1); }
+void twoTones(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = 2000*sin(2*M_PI*10*i/N_FFT) + 20*sin(2*M_PI*100.3*i/N_FFT); }	// (40dB apart)
+void quietSine(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = 8*sin(2*M_PI*50.2*i/N_FFT); }	// (Has to be normalized up a lot)
+void fullScaleSquare(int16_t* x){ for (uint16_t i=0; i<N_FFT; ++i) x[i] = ((i/16) & 1)? 2047 : -2048; }	// (Lots of harmonics, worst case for overflow)
+void impulse(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = (i == N_FFT/2)? 2047 : 0; }	// (Flat spectrum)
+void noise(int16_t* x)			{ uint32_t r = 1; for (uint16_t i=0; i<N_FFT; ++i) { r = r*1664525 + 1013904223; x[i] = (int16_t)(r >> 16) >> 4; } }
+void silence(int16_t* x)		{ for (uint16_t i=0; i<N_FFT; ++i) x[i] = 0; }
+
+const struct {
+	const char* name;
+	SignalFunc func;
+} signals[] = {{"sineOnBin", sineOnBin}, {"sineOffBin", sineOffBin}, {"twoTones", twoTones}, {"quietSine", quietSine}, {"fullScaleSquare", fullScaleSquare}, {"impulse", impulse}, {"noise", noise}, {"silence", silence}};
+
+
+int main() {
+	static int16_t in[N_FFT];
+	static double re[N_FFT], im[N_FFT];
+	static float magnRef[N_FFT/2 + 1], magnFixed[N_FFT/2 + 1];
+
+	for (const auto& signal : signals) {
+		for (uint8_t window=0; window<=1; ++window) {
+			signal.func(in);
+			computeFFTdouble(in, magnRef, re, im, window);
+			computeFFTfixed(in, magnFixed, window);
+
+			float peak = 0, maxErr = 0;
+			for (uint16_t i=0; i<=N_FFT/2; ++i) peak = max(peak, magnRef[i]);
+			const float tolerance = FFT_TOLERANCE_PEAK*peak + FFT_TOLERANCE_ABS;
+			uint16_t badBins = 0;
+			for (uint16_t i=0; i<=N_FFT/2; ++i) {
+				const float err = fabsf(magnFixed[i] - magnRef[i]);
+				maxErr = max(maxErr, err);
+				if (err > tolerance && badBins++ < 5) fprintf(stderr, "%s (%s window): bin %u: fixed %.2f, double %.2f\n", signal.name, window? "Hamming":"no", i, magnFixed[i], magnRef[i]);
+			}
+			printf("%-16s %-7s window: peak %9.1f, max |err| %6.2f (%.4f%% of peak)\n", signal.name, window? "Hamming":"no", peak, maxErr, (peak > 0)? 100*maxErr/peak : 0);
+			CHECK_MSG(badBins == 0, "%s (%s window): %u bins off by more than %.2f", signal.name, window? "Hamming":"no", badBins, tolerance);
+		}
+	}
+
+	return hostTestResult("fftAccuracy");
+}
@@ -0,0 +1,71 @@
+/******      Host benchmarks: runs the benchmark suite (see benchmark.h) on the PC and checks its output is well-formed. Pass "fft" to run benchmarkFFT too      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "GPIO.h"
+#include "audio.h"
+#include "fileIO.h"
+#include "ledStrip.h"
+#include "benchmark.h"
+#include "persistence.h"
+#include "FFT.h"
+#include <vector>
+#include <string>
+
+#define BENCH_EFFECTS	6	// Effects runBenchmarks times (one effectFunc line each)
+
+
+/**********************      BenchmarkOutput      **********************/
+class BenchmarkOutput : public Print {	// Prints to stdout, and keeps every line so they can be checked afterwards
+public:
+	std::vector<std::string> lines;
+
+	size_t write(uint8_t c) {
+		if (c == '\n') {
+			lines.push_back(line);
+			line.clear();
+		} else {
+			line += (char)c;
+		}
+		return fwrite(&c, 1, 1, stdout);
+	}
+
+protected:
+	std::string line;
+};
+
+
+int main(int argc, char* argv[]) {
+	// Real clock (ESP.getCycleCount counts host ns), so the timings are those of this PC: only useful to compare variants against each other
+	curr_time = millis();
+	setupIOpins();
+	setupAudio();
+	setupFileIO();
+	setupPersistence();
+	setupLedStrip();
+
+	BenchmarkOutput out;
+	runBenchmarks(out);
+
+	uint16_t info = 0, effects = 0;
+	for (const std::string& line : out.lines) {
+		DynamicJsonBuffer jsonBuffer;
+		std::string json(line);
+		JsonObject& obj = jsonBuffer.parseObject(&json[0]);
+		CHECK_MSG(obj.success(), "Not a JSON object: %s", line.c_str());
+		if (!obj.success()) continue;
+		const char* bench = obj["bench"];
+		CHECK_MSG(bench != NULL, "No bench: %s", line.c_str());
+		if (!bench) continue;
+		CHECK_MSG(strcmp(bench, "error") != 0, "%s", line.c_str());
+		if (strcmp(bench, "info") == 0) ++info;
+		if (strcmp(bench, "effectFunc") == 0) ++effects;
+		if (obj.containsKey("calls")) CHECK_MSG(obj["calls"].as<uint32_t>() > 0, "No calls: %s", line.c_str());
+	}
+	CHECK_MSG(info == 1, "%u info lines", info);
+	CHECK_MSG(effects == BENCH_EFFECTS, "%u effects benchmarked, expected %u", effects, BENCH_EFFECTS);
+	CHECK_MSG(!SPIFFS.exists(BENCHMARK_CONFIG_PATH) && !SPIFFS.exists(BENCHMARK_PLAYLIST_PATH), "Temporary files left behind");
+
+	if (argc > 1 && strcmp(argv[1], "fft") == 0) benchmarkFFT(out);	// (Plain text, not checked)
+
+	return hostTestResult("hostBenchmarks");
+}
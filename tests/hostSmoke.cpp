@@ -0,0 +1,44 @@
+/******      Host smoke test: boots the sketch's audio and LED pipeline on the virtual clock and runs it for a while      ******/
+#include "hostTest.h"
+#include "main.h"
+#include "GPIO.h"
+#include "audio.h"
+#include "fileIO.h"
+#include "ledStrip.h"
+#include "scheduler.h"
+#include "persistence.h"
+
+#define SMOKE_RUN_MS	20000	// (ms) Long enough for the default effect list to move on a few times
+
+
+int main() {
+	hostUseVirtualClock(true);	// (So sample_isr runs at F_SAMPLING and nothing depends on how fast the host is)
+	curr_time = millis();
+	setupIOpins();
+	setupAudio();
+	setupFileIO();
+	setupPersistence();
+	setupLedStrip();
+	addSchedulerTask("audio",    processAudio,    0,                        audioFrameReady, 20, PROFILE_AUDIO);
+	addSchedulerTask("ledStrip", processLedStrip, LED_STRIP_FRAME_INTERVAL, NULL,            5,  PROFILE_LED_STRIP);
+	addSchedulerIdleTask("persist", processPersistence, persistencePending, PROFILE_PERSIST);
+
+	while (millis() < SMOKE_RUN_MS) runScheduler();
+
+	const uint32_t expectedFrames = (uint64_t)SMOKE_RUN_MS*F_SAMPLING/1000/stftHopSize;
+	CHECK_MSG(getAudioFrame().id + 2 >= expectedFrames, "%u audio frames, expected %u", getAudioFrame().id, expectedFrames);
+	CHECK_MSG(adcRing.getOverruns() == 0, "%u ADC overruns", adcRing.getOverruns());
+	CHECK_MSG(hostTimerServiced() == hostTimerExpirations(), "%u of %u samples lost", hostTimerExpirations() - hostTimerServiced(), hostTimerExpirations());
+	CHECK_MSG(ledFramesRendered >= SMOKE_RUN_MS/LED_STRIP_FRAME_INTERVAL/2, "%u LED frames rendered", ledFramesRendered);
+	CHECK(ledFramesPushed > 0);
+
+	// The effect list survives a round trip through SPIFFS
+	const uint8_t numEffects = stripEffects.getNumEffects();
+	CHECK(stripEffects.saveConfigToFile());
+	stripEffects.clear();
+	CHECK(stripEffects.loadConfigFromFile());
+	CHECK_MSG(stripEffects.getNumEffects() == numEffects, "%u effects loaded, %u saved", stripEffects.getNumEffects(), numEffects);
+	flushPersistence();
+
+	return hostTestResult("hostSmoke");
+}
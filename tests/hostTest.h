@@ -0,0 +1,29 @@
+/******      Host test helpers      ******/
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+
+#define CHECK(cond)				hostCheck((cond), __FILE__, __LINE__, #cond)
+#define CHECK_MSG(cond, ...)	do { if (!CHECK(cond)) { fprintf(stderr, "    "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } } while (0)
+
+inline int hostTestFailures = 0;
+
+
+/**************************************************/
+/******      Host test helper functions      ******/
+/**************************************************/
+inline bool hostCheck(bool ok, const char* file, int line, const char* cond) {	// Reports (and counts) a failed check, and returns ok so the caller can print more details
+	if (!ok) {
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, cond);
+		++hostTestFailures;
+	}
+	return ok;
+}
+
+inline int hostTestResult(const char* name) {	// What main returns: 0 if every check passed
+	printf("%s: %s (%d failed checks)\n", name, hostTestFailures? "FAILED":"passed", hostTestFailures);
+	return hostTestFailures? 1 : 0;
+}
+
+#endif
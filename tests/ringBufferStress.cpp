@@ -0,0 +1,63 @@
+/******      SPSCRingBuffer stress test: a producer thread stands in for sample_isr, the main thread consumes like the STFT does (run under TSan)      ******/
+#include "hostTest.h"
+#include "ringBuffer.h"
+#include <thread>
+#include <random>
+#include <algorithm>
+
+#define STRESS_RING_SIZE	64			// (Power of 2) Small, so the indices wrap around all the time and the producer overruns the consumer every now and then
+#define STRESS_N_ITEMS		2000000		// Number of items the producer tries to push
+
+SPSCRingBuffer<uint32_t, STRESS_RING_SIZE> ring;
+
+
+/***********************************************/
+/******      Producer (ISR stand-in)      ******/
+/***********************************************/
+uint32_t produce() {	// Pushes 1..STRESS_N_ITEMS (in bursts, like samples piling up while the main loop is busy) and returns how many were dropped
+	std::minstd_rand rng(1);
+	uint32_t dropped = 0;
+	for (uint32_t i=1; i<=STRESS_N_ITEMS; ++i) {
+		if (!ring.push(i)) ++dropped;
+		if (rng() % 32 == 0) std::this_thread::yield();
+	}
+	return dropped;
+}
+
+
+int main() {
+	uint32_t dropped = 0;
+	std::atomic<bool> done(false);
+	std::thread producer([&]() { dropped = produce(); done.store(true, std::memory_order_release); });
+
+	// Consumer: reads random-sized chunks through peek/consume and checks every item arrives in order (a gap means the items in between were dropped)
+	std::minstd_rand rng(2);
+	uint32_t last = 0, received = 0, gaps = 0, maxAvailable = 0, outOfOrder = 0;
+	while (true) {
+		const bool producerDone = done.load(std::memory_order_acquire);	// (Read before the ring: if it was done, whatever it pushed is visible below)
+		const uint32_t available = ring.available();
+		maxAvailable = std::max(maxAvailable, available);
+		const uint32_t* span;
+		const uint16_t n = std::min<uint16_t>(ring.peek(span), 1 + rng() % STRESS_RING_SIZE);
+		for (uint16_t i=0; i<n; ++i) {
+			if (span[i] <= last) ++outOfOrder;
+			gaps += span[i] - last - 1;
+			last = span[i];
+		}
+		received += n;
+		ring.consume(n);
+		if (n == 0 && producerDone) break;
+		if (n == 0 || rng() % 8 == 0) std::this_thread::yield();
+	}
+	producer.join();
+
+	CHECK_MSG(outOfOrder == 0, "%u items read out of order", outOfOrder);
+	CHECK_MSG(maxAvailable <= STRESS_RING_SIZE, "available() reported %u items (capacity: %u)", maxAvailable, STRESS_RING_SIZE);
+	CHECK_MSG(received + dropped == STRESS_N_ITEMS, "%u received + %u dropped != %u pushed", received, dropped, STRESS_N_ITEMS);
+	CHECK_MSG(gaps == dropped, "%u items missing from the sequence, %u dropped", gaps, dropped);
+	CHECK_MSG(ring.getOverruns() == dropped, "getOverruns()=%u, push returned false %u times", ring.getOverruns(), dropped);
+	CHECK_MSG(ring.getTotalPushed() == received, "getTotalPushed()=%u, %u received", ring.getTotalPushed(), received);
+	CHECK(ring.available() == 0);
+	printf("%u items received, %u dropped\n", received, dropped);
+	return hostTestResult("ringBufferStress");
+}
@@ -1,11 +1,14 @@
 /******      Web Server      ******/
 #include "webServer.h"
 #include "ledStrip.h"					// LED strip library needed to show config files associated with the effect list. Have to include it in the cpp file or else circular import errors are hard to deal with
+#include "benchmark.h"					// Benchmark suite (can be started from serverSecret or webSocketConsole)
+#include "profiler.h"					// Per-stage loop timing
+#include "scheduler.h"					// Task stats (runs, missed deadlines)
 
 char hostName[32];
 AsyncWebServer serverPublic(PORT_PUBLIC_SETTS), serverSecret(SECRET_SERVER_PORT);
 ESP8266HTTPUpdateServer server_OTA_uploader;
-WebSocketsServer webSocketConsole(PORT_WEBSOCKET_CONSOLE), webSocketFFT(PORT_WEBSOCKET_FFT);
+WebSocketsServer webSocketConsole(PORT_WEBSOCKET_CONSOLE), webSocketFFT(PORT_WEBSOCKET_FFT), webSocketControl(PORT_WEBSOCKET_CONTROL);
 bool shouldReboot = false;
 
 
@@ -60,7 +63,27 @@ void setupWebServer() {	// Initialize hostName, mDNS, web server, OTA methods (H
 	serverSecret.on(SF("/WiFiNets").c_str(), HTTP_GET, secretSettingsWLANscan);
 	serverSecret.on(SF("/WiFiSave").c_str(), HTTP_POST, secretSettingsWLANsave);
 	serverSecret.on(SF("/listEffects").c_str(), HTTP_GET, secretSettingsListLEDeffects);
-	serverSecret.on(SF("/heap").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { AsyncWebServerResponse* response = request->beginResponse(200, CONT(TYPE_PLAIN), String(ESP.getFreeHeap()) + F(" B")); addNoCacheHeaders(response); response->addHeader(F("Refresh"), F("2")); request->send(response); });
+	serverSecret.on(SF("/heap").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { AsyncWebServerResponse* response = request->beginResponse(200, CONT(TYPE_PLAIN), String(ESP.getFreeHeap()) + F(" B (lowest during config I/O: ") + String(ConfigJson::heapLow) + F(" B); config JSON arena: ") + String(ConfigJson::arenaLast) + '/' + String(ConfigJson::arenaPeak) + '/' + String(CONFIG_ARENA_SIZE) + F(" B (last/peak/size)")); addNoCacheHeaders(response); response->addHeader(F("Refresh"), F("2")); request->send(response); });
+	serverSecret.on(SF("/profile").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { AsyncResponseStream* response = request->beginResponseStream(CONT(TYPE_JSON)); addNoCacheHeaders(response); printProfilerJSON(*response); if (request->hasParam("reset")) resetProfiler(); request->send(response); });
+	serverSecret.on(SF("/persist").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { AsyncResponseStream* response = request->beginResponseStream(CONT(TYPE_JSON)); addNoCacheHeaders(response); printPersistenceJSON(*response); request->send(response); });
+	serverSecret.on(SF("/scheduler").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { AsyncResponseStream* response = request->beginResponseStream(CONT(TYPE_JSON)); addNoCacheHeaders(response); printSchedulerJSON(*response); request->send(response); });
+	serverSecret.on(SF("/strip").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {	// ?brightness=0-255, ?dither=0|1 and/or ?budget=mA change the output stage settings
+		const long brightness = request->hasParam("brightness")? request->getParam("brightness")->value().toInt() : ledBrightness;
+		const long budget = request->hasParam("budget")? request->getParam("budget")->value().toInt() : ledPowerBudget;
+		if (brightness < 0 || brightness > 255 || budget < 0 || budget > 0xFFFF) {	// (Rather than silently wrapping around into uint8_t/uint16_t)
+			request->send(400, CONT(TYPE_PLAIN), F("brightness must be 0-255 and budget 0-65535 (mA)"));
+			return;
+		}
+		if (request->hasParam("brightness") || request->hasParam("dither")) {
+			setLedOutput(brightness, request->hasParam("dither")? request->getParam("dither")->value().toInt() != 0 : ledDither);
+		}
+		if (request->hasParam("budget")) setLedPowerBudget(budget);
+		AsyncWebServerResponse* response = request->beginResponse(200, CONT(TYPE_JSON), SF("{\"framesRendered\":") + ledFramesRendered + F(",\"framesPushed\":") + ledFramesPushed + F(",\"framesDeferred\":") + ledFramesDeferred + F(",\"method\":") + LED_STRIP_METHOD + F(",\"brightness\":") + ledBrightness + F(",\"dither\":") + (ledDither? F("true"):F("false")) + F(",\"budgetmA\":") + ledPowerBudget + F(",\"estimatedmA\":") + ledCurrentEstimate + F(",\"limitedmA\":") + ledCurrentLimited + F(",\"limiterScale\":") + String(ledLimiterScale/65536.0, 3) + F(",\"framesLimited\":") + ledFramesLimited + F("}"));
+		addNoCacheHeaders(response);
+		request->send(response);
+	});
+	serverSecret.on(SF("/bench").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { benchmarkRequested = true; AsyncWebServerResponse* response = request->beginResponse(200, CONT(TYPE_PLAIN), F("Benchmarks will run on the next loop, results (JSON lines) will be printed to the console")); addNoCacheHeaders(response); request->send(response); });
+	serverSecret.on(SF("/benchFFT").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) { benchmarkFFTrequested = true; AsyncWebServerResponse* response = request->beginResponse(200, CONT(TYPE_PLAIN), F("The FFT benchmark will run on the next loop, results will be printed to the console")); addNoCacheHeaders(response); request->send(response); });
 
 	serverSecret.on("/secretOTA", HTTP_GET, [](AsyncWebServerRequest* request) {
 		request->send(200, CONT(TYPE_HTML), F("<form method='POST' action='/secretOTA' enctype='multipart/form-data'><input type='file' name='update'><input type='submit' value='Update'></form>"));
@@ -172,6 +195,9 @@ void setupWebServer() {	// Initialize hostName, mDNS, web server, OTA methods (H
 	webSocketFFT.onEvent(webSocketFFTevent);
 	webSocketConsole.begin();
 	webSocketConsole.onEvent(webSocketConsoleEvent);
+	webSocketControl.setAuthorization(SECRET_SERVER_USER, SECRET_SERVER_PASS);	// Its changes are persisted, so it takes the same credentials as SPIFFSEditor (HTTP basic auth on the handshake, eg: ws://user:pass@hostName:83)
+	webSocketControl.begin();
+	webSocketControl.onEvent(webSocketControlEvent);
 }
 
 
@@ -368,9 +394,32 @@ void webSocketConsoleEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t
 	case WStype_CONNECTED:
 		webSocketConsole.broadcastTXT("Connected");	// send message to client to confirm connection ok
 		break;
+	case WStype_TEXT:
+		if (strcmp_P((const char*)payload, PSTR("bench")) == 0) benchmarkRequested = true;	// Run it from processWebServer, not from inside the webSocket callback
+		break;
+	case WStype_ERROR:
+	case WStype_DISCONNECTED:
+	case WStype_BIN:
+	default:
+		break;
+	}
+}
+
+void webSocketControlEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t lenght) {	// webSocketControl event callback function
+	String reply;
+	switch(type) {
+	case WStype_CONNECTED: {
+		char list[] = "{\"cmd\":\"list\"}";	// Start by sending the current effect list (mutable: the command is parsed in place)
+		reply = runLedControlCommand(list);
+		webSocketControl.sendTXT(num, reply);
+		break;
+	}
+	case WStype_TEXT:	// Commands run right here (this is called from webSocketControl.loop(), so never in the middle of a frame) and show up on the next frame
+		reply = runLedControlCommand((char*)payload);
+		webSocketControl.sendTXT(num, reply);
+		break;
 	case WStype_ERROR:
 	case WStype_DISCONNECTED:
-	case WStype_TEXT:
 	case WStype_BIN:
 	default:
 		break;
@@ -387,31 +436,52 @@ void consolePrintf(const char * format, ...) {	// Log messages through webSocket
 	Serial.printf(buf);
 }
 
+size_t ConsolePrint::write(uint8_t c) {
+	line[len++] = c;
+	if (c == '\n' || len >= sizeof(line)-1) sendLine();	// Leave room for the '\0'
+	return 1;
+}
+
+void ConsolePrint::sendLine() {	// Sends whatever is buffered (even if there's no '\n' yet)
+	if (len == 0) return;
+	line[len] = '\0';
+	consolePrintf("%s", line);	// Don't use line as the format string, it could contain '%'
+	len = 0;
+}
+
 int constexpr precompute_strlen(const char* str) {
     return *str ? 1 + precompute_strlen(str + 1) : 0;
 }
 
 void processWebServer() {	// "secretSettings.loop()" function: handle incoming OTA connections (if any), secret settings http requests and webSocket events
-	static uint32_t last_t_sec = 0;
+	static uint32_t last_t_sec = 0, tLastFFTbroadcast = 0, lastFFTbroadcastId = 0;
+	const AudioFrame& audio = getAudioFrame();
 	uint32_t t_msec = curr_time%1000, t_sec = curr_time/1000, t_min = t_sec/60, t_hr = t_min/60; t_sec %= 60; t_min %= 60;
 //	t_sec = (curr_time>>5) & 0x3;	// Every 32ms
 	if (t_sec != last_t_sec) {
+		static uint32_t tLastAdcCheck = 0, lastAdcSamples = 0;
+		uint32_t adcSamples = adcRing.getTotalPushed() + adcRing.getOverruns();	// Every sample_isr call either pushes or overruns
+		uint32_t adcRate = (curr_time > tLastAdcCheck)? (uint64_t)(adcSamples - lastAdcSamples)*1000/(curr_time - tLastAdcCheck) : 0;	// Sampling cadence check: should stay at F_SAMPLING regardless of what the strip is doing
+		tLastAdcCheck = curr_time;
+		lastAdcSamples = adcSamples;
 		last_t_sec = t_sec;
-		consolePrintF("Still alive (t=%3d:%02d'%02d\"); cur vol: %10d, avg vol: %10d; HEAP: %5d B\n", t_hr, t_min, t_sec, int(curr_volume), int(avg_volume), ESP.getFreeHeap());
+		consolePrintF("Still alive (t=%3d:%02d'%02d\"); cur vol: %10d, avg vol: %10d; ADC rate: %5u Hz%s, overruns: %u; LED frames rendered/pushed/deferred/limited: %u/%u/%u/%u, current: %u mA (%u mA unlimited); HEAP: %5d B\n", t_hr, t_min, t_sec, int(audio.volume), int(audio.avgVolume), adcRate, (abs((int32_t)adcRate - (int32_t)F_SAMPLING) > F_SAMPLING/100)? " (!)":"", adcRing.getOverruns(), ledFramesRendered, ledFramesPushed, ledFramesDeferred, ledFramesLimited, ledCurrentLimited, ledCurrentEstimate, ESP.getFreeHeap());
 	}
 
-	if (adc_buf_got_full) {
-		adc_buf_got_full = false;	// Remember to reset this flag so we only send when the next buffer is full ;)
-		unsigned int buf_id = !adc_buf_id_current;	// Use the *opposite* buffer id of the one being filled currently (so we send the one that's already full)
-
-		performFFT(buf_id);
-
-		webSocketFFT.broadcastBIN(reinterpret_cast<uint8_t*>(fft_real), sizeof(fft_real[0])*(1 + N_FFT/2));
+	if (audio.id != lastFFTbroadcastId && curr_time-tLastFFTbroadcast >= FFT_BROADCAST_INTERVAL) {	// The STFT produces a new spectrum every stftHopSize samples, but streaming all of them would flood the webSocket
+		tLastFFTbroadcast = curr_time;
+		lastFFTbroadcastId = audio.id;
+		webSocketFFT.broadcastBIN(reinterpret_cast<uint8_t*>(const_cast<float*>(audio.spectrum)), sizeof(audio.spectrum));
 	}
 	webSocketFFT.loop();
 	webSocketConsole.loop();
+	webSocketControl.loop();
 
-	if (shouldReboot) ESP.restart();	// AsyncWebServer doesn't suggest rebooting from async callbacks, so we set a flag and reboot from here :)
+	processBenchmark();
+	if (shouldReboot) {
+		flushPersistence();	// Don't lose the settings that are still waiting to be written
+		ESP.restart();
+	}	// AsyncWebServer doesn't suggest rebooting from async callbacks, so we set a flag and reboot from here :)
 	
 	#if USE_ARDUINO_OTA
 		ArduinoOTA.handle();
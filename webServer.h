@@ -21,6 +21,9 @@
 #define PORT_PUBLIC_SETTS			80		// Port for public web server
 #define PORT_WEBSOCKET_FFT			81		// Port for the webSocket for FFT debugging purposes
 #define PORT_WEBSOCKET_CONSOLE		82		// Port for the webSocket to which debug Serial.print messages are forwarded
+#define PORT_WEBSOCKET_CONTROL		83		// Port for the webSocket that edits the effect lists live (see runLedControlCommand). Requires SECRET_SERVER_USER/SECRET_SERVER_PASS
+#define FFT_BROADCAST_INTERVAL		100		// (ms) Minimum time between spectra streamed through webSocketFFT
+#define WEB_SERVER_POLL_INTERVAL	5		// (ms) How often processWebServer services the webSockets (the HTTP servers are async and don't need it)
 
 
 #define CONT(x)						String(FPSTR(contentType_P[x]))	// Helper macro to specify a MIME content type as a String from a PROGMEM copy
@@ -38,6 +41,19 @@
 extern ESP8266HTTPUpdateServer server_OTA_uploader;*/
 extern WebSocketsServer webSocketConsole;
 
+class ConsolePrint : public Print {	// Print adapter that sends whatever is printed to it through consolePrintf, one line at a time (so long reports can go to webSocketConsole and Serial)
+public:
+	ConsolePrint() : len(0) {}
+	~ConsolePrint() { sendLine(); }
+
+	size_t write(uint8_t c);
+	void sendLine();	// Sends whatever is buffered (even if there's no '\n' yet)
+
+protected:
+	char line[256];
+	uint16_t len;
+};
+
 enum {TYPE_PLAIN=0, TYPE_HTML, TYPE_JSON, TYPE_CSS, TYPE_JS, TYPE_PNG, TYPE_GIF, TYPE_JPG, TYPE_ICO, TYPE_XML, TYPE_PDF, TYPE_ZIP, TYPE_GZ, TYPE_DLOAD};
 const char* const PROGMEM contentType_P[] = {"text/plain", "text/html", "text/json", "text/css", "application/javascript", "image/png", "image/gif", "image/jpeg", "image/x-icon", "text/xml", "application/x-pdf", "application/x-zip", "application/x-gzip", "application/octet-stream"};
 
@@ -63,6 +79,7 @@ void secretSettingsWLANsave(AsyncWebServerRequest* request);	// Handles secret H
 void secretSettingsListLEDeffects(AsyncWebServerRequest* request);	// Lists all config files related to LED strip effects
 void webSocketFFTevent(uint8_t num, WStype_t type, uint8_t * payload, size_t lenght);	// webSocketFFT event callback function
 void webSocketConsoleEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t lenght);	// webSocketConsole event callback function
+void webSocketControlEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t lenght);	// webSocketControl event callback function
 void consolePrintf(const char * format, ...);	// Log messages through webSocketConsole and Serial
 int constexpr precompute_strlen(const char* str);
 void processWebServer();	// "secretSettings.loop()" function: handle incoming OTA connections (if any), secret settings http requests and webSocket events